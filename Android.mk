@@ -65,6 +65,7 @@ LOCAL_SRC_FILES := \
 	gme/M3u_Playlist.cpp \
 	gme/Multi_Buffer.cpp \
 	gme/Music_Emu.cpp \
+	gme/Music_Stream.cpp \
 	gme/Nes_Apu.cpp \
 	gme/Nes_Cpu.cpp \
 	gme/Nes_Fme7_Apu.cpp \
@@ -0,0 +1,315 @@
+/* Measures how fast each file renders, at several sample rates and in stereo,
+multi-channel and effects modes. Prints one CSV line per run, so that outputs
+of two builds can be compared directly.
+
+Usage: gme_benchmark [-s seconds] [-r rate,rate...] [-n repeats] [-t track]
+        [-q draft|normal|high] [file...]
+
+Defaults to 30 seconds of each file in the corpus (test/corpus, one small
+generated file per format and NSF expansion chip, see make_corpus.py there) and
+test.vgz, at 32000, 44100 and 48000 Hz, best of 3 runs. A rate of "native" uses the file's preferred sample rate (see
+gme_preferred_sample_rate()), and is skipped for files without one. Columns:
+
+system,file,track,detail   what was rendered; detail lists NSF expansion chips
+                           and the YM2612 core used for VGM and GYM
+rate,mode,channels         output format
+quality                    quality tier (see gme_set_quality())
+audio_sec,cpu_sec          length rendered and processor time it took
+realtime                   audio_sec / cpu_sec
+ns_per_sample              processor time per sample frame
+emulate,lookahead,mix,resample
+                           share of play time in each stage; emulate includes
+                           the other three (see gme_stats_t)
+setup_allocs               allocations made by loading and starting the track
+play_allocs,play_bytes     allocations made while playing, ideally none
+                           (-1 where allocations can't be counted) */
+
+#include "gme/gme.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#ifndef GME_BENCH_YM2612
+	#define GME_BENCH_YM2612 "default"
+#endif
+
+/* Allocation counting. With glibc, the library's malloc() calls (including
+those made by operator new) can be intercepted and passed on. Sanitizers
+replace malloc() themselves, so counting is left out under them. */
+
+static long alloc_count;
+static long alloc_bytes;
+
+#if defined (__has_feature)
+	#if __has_feature (address_sanitizer) || __has_feature (thread_sanitizer) || \
+			__has_feature (memory_sanitizer)
+		#define BENCH_SANITIZED 1
+	#endif
+#endif
+
+#if defined (__SANITIZE_ADDRESS__) || defined (__SANITIZE_THREAD__)
+	#define BENCH_SANITIZED 1
+#endif
+
+#if defined (__GLIBC__) && !defined (BENCH_SANITIZED)
+	#define BENCH_COUNTS_ALLOCS 1
+
+	extern void* __libc_malloc( size_t );
+	extern void* __libc_calloc( size_t, size_t );
+	extern void* __libc_realloc( void*, size_t );
+
+	void* malloc( size_t n )
+	{
+		alloc_count++;
+		alloc_bytes += (long) n;
+		return __libc_malloc( n );
+	}
+
+	void* calloc( size_t count, size_t n )
+	{
+		alloc_count++;
+		alloc_bytes += (long) (count * n);
+		return __libc_calloc( count, n );
+	}
+
+	void* realloc( void* p, size_t n )
+	{
+		alloc_count++;
+		alloc_bytes += (long) n;
+		return __libc_realloc( p, n );
+	}
+#else
+	#define BENCH_COUNTS_ALLOCS 0
+#endif
+
+enum { mode_stereo, mode_multi, mode_effects, mode_count };
+static const char* const mode_names [mode_count] = { "stereo", "multi", "effects" };
+
+static const char* const quality_names [3] = { "draft", "normal", "high" };
+
+static void handle_error( const char* str )
+{
+	if ( str )
+	{
+		fprintf( stderr, "Error: %s\n", str );
+		exit( EXIT_FAILURE );
+	}
+}
+
+static double cpu_seconds( void )
+{
+	return (double) clock() / CLOCKS_PER_SEC;
+}
+
+/* Names of NSF expansion chips, from header flags */
+static void nsf_chips( const char* path, char* out, size_t out_size )
+{
+	static const char* const names [6] = { "vrc6", "vrc7", "fds", "mmc5", "namco", "fme7" };
+	unsigned char header [0x80];
+	FILE* in = fopen( path, "rb" );
+	size_t size = 0;
+	int i;
+
+	strcpy( out, "apu" );
+	if ( !in )
+		return;
+	size = fread( header, 1, sizeof header, in );
+	fclose( in );
+
+	if ( size < sizeof header || memcmp( header, "NESM\x1A", 5 ) )
+		return;
+
+	for ( i = 0; i < 6; i++ )
+	{
+		if ( (header [0x7B] >> i & 1) && strlen( out ) + strlen( names [i] ) + 2 < out_size )
+		{
+			strcat( out, "+" );
+			strcat( out, names [i] );
+		}
+	}
+}
+
+static void describe( const char* path, gme_type_t type, char* out, size_t out_size )
+{
+	out [0] = 0;
+	if ( type == gme_nsf_type )
+		nsf_chips( path, out, out_size );
+	else if ( type == gme_vgm_type || type == gme_vgz_type || type == gme_gym_type )
+		snprintf( out, out_size, "ym2612=%s", GME_BENCH_YM2612 );
+}
+
+/* Renders seconds of track in given mode, best of repeats. Returns 0 if mode
+isn't supported by file's emulator. */
+static int bench( const char* path, int track, long rate, int mode, int quality,
+		int seconds, int repeats )
+{
+	#define buf_size 4096 /* multiple of 16 channels */
+	static short buf [buf_size];
+
+	gme_type_t type;
+	Music_Emu* emu;
+	Music_Emu* info;
+	gme_stats_t stats;
+	char detail [64];
+	long setup_allocs, play_allocs = -1, play_bytes = -1;
+	long total, frames;
+	double best = -1.0;
+	int channels, i;
+
+	handle_error( gme_identify_file( path, &type ) );
+	if ( !type )
+		handle_error( "Unsupported music type" );
+
+	if ( !rate )
+	{
+		handle_error( gme_open_file( path, &info, gme_info_only ) );
+		rate = gme_preferred_sample_rate( info );
+		gme_delete( info );
+		if ( !rate )
+			return 0;
+	}
+
+	alloc_count = 0;
+	emu = (mode == mode_multi) ? gme_new_emu_multi_channel( type, rate ) : gme_new_emu( type, rate );
+	if ( !emu )
+		handle_error( "Out of memory" );
+	handle_error( gme_set_quality( emu, quality ) );
+	handle_error( gme_load_file( emu, path ) );
+
+	if ( mode == mode_multi && !gme_multi_channel( emu ) )
+	{
+		gme_delete( emu );
+		return 0;
+	}
+	if ( mode == mode_effects )
+		gme_set_stereo_depth( emu, 0.5 );
+	gme_enable_stats_timing( emu, 1 );
+
+	channels = gme_multi_channel( emu ) ? 16 : 2;
+	total = (long) seconds * rate * channels;
+	memset( &stats, 0, sizeof stats );
+
+	for ( i = 0; i < repeats; i++ )
+	{
+		long n;
+		long allocs_before, bytes_before;
+		double start, elapsed;
+
+		handle_error( gme_start_track( emu, track ) );
+		/* keep silence detection from ending the track early */
+		gme_ignore_silence( emu, 1 );
+		if ( i == 0 )
+			setup_allocs = alloc_count;
+
+		allocs_before = alloc_count;
+		bytes_before  = alloc_bytes;
+		start = cpu_seconds();
+		for ( n = 0; n < total; n += buf_size )
+			handle_error( gme_play( emu, buf_size, buf ) );
+		elapsed = cpu_seconds() - start;
+
+		if ( best < 0 || elapsed < best )
+		{
+			best = elapsed;
+			gme_get_stats( emu, &stats );
+			if ( BENCH_COUNTS_ALLOCS )
+			{
+				play_allocs = alloc_count - allocs_before;
+				play_bytes  = alloc_bytes - bytes_before;
+			}
+		}
+	}
+	if ( !BENCH_COUNTS_ALLOCS )
+		setup_allocs = -1;
+	if ( best <= 0 )
+		best = 1.0 / CLOCKS_PER_SEC; /* too fast to measure */
+
+	describe( path, type, detail, sizeof detail );
+	frames = total / channels;
+
+	#define SHARE( t ) (stats.play_nsec ? (double) stats.t / stats.play_nsec : 0.0)
+	printf( "%s,%s,%d,%s,%ld,%s,%s,%d,%d,%.4f,%.1f,%.1f,%.3f,%.3f,%.3f,%.3f,%ld,%ld,%ld\n",
+			gme_type_system( type ), path, track, detail, rate, mode_names [mode],
+			quality_names [quality - gme_quality_draft], channels,
+			seconds, best, seconds / best, best * 1e9 / frames,
+			SHARE( emulate_nsec ), SHARE( lookahead_nsec ), SHARE( mix_nsec ), SHARE( resample_nsec ),
+			setup_allocs, play_allocs, play_bytes );
+	fflush( stdout );
+
+	gme_delete( emu );
+	return 1;
+}
+
+int main( int argc, char* argv [] )
+{
+	static const char* const default_files [] = {
+		"corpus/nes_apu.nsf", "corpus/nes_vrc6.nsf", "corpus/nes_vrc7.nsf", "corpus/nes_fds.nsf",
+		"corpus/nes_mmc5.nsf", "corpus/nes_namco.nsf", "corpus/nes_fme7.nsf", "corpus/snes.spc",
+		"corpus/genesis.gym", "corpus/gameboy.gbs", "corpus/msx.kss", "corpus/pce.hes",
+		"corpus/atari.sap", "corpus/spectrum.ay", "test.vgz"
+	};
+	int const default_count = sizeof default_files / sizeof default_files [0];
+	long rates [16] = { 32000, 44100, 48000 };
+	int rate_count = 3;
+	int seconds = 30;
+	int repeats = 3;
+	int track = 0;
+	int quality = gme_quality_normal;
+	int first_file;
+	int i;
+
+	for ( i = 1; i < argc && argv [i] [0] == '-' && argv [i] [1]; i += 2 )
+	{
+		const char* arg = (i + 1 < argc) ? argv [i + 1] : NULL;
+		if ( !arg )
+			handle_error( "Option is missing its value" );
+
+		switch ( argv [i] [1] )
+		{
+		case 's': seconds = atoi( arg ); break;
+		case 'n': repeats = atoi( arg ); break;
+		case 't': track   = atoi( arg ); break;
+		case 'q':
+			for ( quality = 0; quality < 3 && strcmp( arg, quality_names [quality] ); )
+				quality++;
+			if ( quality >= 3 )
+				handle_error( "Quality must be draft, normal or high" );
+			quality += gme_quality_draft;
+			break;
+		case 'r':
+			for ( rate_count = 0; *arg && rate_count < 16; rate_count++ )
+			{
+				char* end = (char*) arg + 6;
+				if ( !strncmp( arg, "native", 6 ) )
+					rates [rate_count] = 0;
+				else if ( (rates [rate_count] = strtol( arg, &end, 10 )) <= 0 || end == arg )
+					handle_error( "Invalid sample rate" );
+				arg = (*end == ',') ? end + 1 : end;
+			}
+			break;
+		default:
+			fprintf( stderr, "Usage: %s [-s seconds] [-r rate,rate...] [-n repeats] [-t track]"
+					" [-q draft|normal|high] [file...]\n", argv [0] );
+			return EXIT_FAILURE;
+		}
+	}
+	if ( seconds < 1 ) seconds = 1;
+	if ( repeats < 1 ) repeats = 1;
+	first_file = i;
+
+	printf( "system,file,track,detail,rate,mode,quality,channels,audio_sec,cpu_sec,realtime,ns_per_sample,"
+			"emulate,lookahead,mix,resample,setup_allocs,play_allocs,play_bytes\n" );
+
+	for ( i = first_file; i < (first_file < argc ? argc : first_file + default_count); i++ )
+	{
+		const char* path = (first_file < argc) ? argv [i] : default_files [i - first_file];
+		int r, mode;
+		for ( r = 0; r < rate_count; r++ )
+			for ( mode = 0; mode < mode_count; mode++ )
+				bench( path, track, rates [r], mode, quality, seconds, repeats );
+	}
+
+	return 0;
+}
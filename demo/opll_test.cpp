@@ -0,0 +1,137 @@
+// Checks that opening a YM2413 VGM with a non-NTSC clock on another thread
+// doesn't disturb a VRC7 NSF that's playing. emu2413's tables are shared by
+// every instance, so neither may rewrite them once built; run under
+// -fsanitize=thread to catch that. Both files are built in memory.
+
+// Usage: gme_opll_test
+
+#include "gme/gme.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+
+static void handle_error( const char* str )
+{
+	if ( str )
+	{
+		fprintf( stderr, "Error: %s\n", str );
+		exit( EXIT_FAILURE );
+	}
+}
+
+static void set_le16( unsigned char* p, unsigned n )
+{
+	p [0] = (unsigned char) n;
+	p [1] = (unsigned char) (n >> 8);
+}
+
+static void set_le32( unsigned char* p, unsigned long n )
+{
+	set_le16( p, (unsigned) (n & 0xFFFF) );
+	set_le16( p + 2, (unsigned) (n >> 16) );
+}
+
+// NSF whose init routine keys on one VRC7 voice
+static unsigned char nsf [0x80 + 0x40];
+
+static void make_nsf()
+{
+	static unsigned char const code [] = {
+		0xA9, 0x30, 0x8D, 0x10, 0x90, // LDA #$30 STA $9010
+		0xA9, 0x10, 0x8D, 0x30, 0x90, // LDA #$10 STA $9030 ; patch 1
+		0xA9, 0x10, 0x8D, 0x10, 0x90, // LDA #$10 STA $9010
+		0xA9, 0x80, 0x8D, 0x30, 0x90, // LDA #$80 STA $9030 ; fnum
+		0xA9, 0x20, 0x8D, 0x10, 0x90, // LDA #$20 STA $9010
+		0xA9, 0x18, 0x8D, 0x30, 0x90, // LDA #$18 STA $9030 ; key on
+		0x60                          // RTS, also the play routine
+	};
+	memcpy( nsf, "NESM\x1A", 5 );
+	nsf [0x05] = 1; // version
+	nsf [0x06] = 1; // track count
+	nsf [0x07] = 1; // first track
+	set_le16( nsf + 0x08, 0x8000 ); // load
+	set_le16( nsf + 0x0A, 0x8000 ); // init
+	set_le16( nsf + 0x0C, 0x8000 + sizeof code - 1 ); // play
+	set_le16( nsf + 0x6E, 16639 ); // NTSC play period
+	nsf [0x7B] = 0x02; // VRC7
+	memcpy( nsf + 0x80, code, sizeof code );
+}
+
+// VGM that plays one YM2413 note at the PAL clock
+static unsigned char vgm [0x40 + 16];
+
+static void make_vgm()
+{
+	static unsigned char const cmds [] = {
+		0x51, 0x30, 0x10,
+		0x51, 0x10, 0x80,
+		0x51, 0x20, 0x18,
+		0x61, 0x44, 0xAC, // wait one second
+		0x66
+	};
+	memcpy( vgm, "Vgm ", 4 );
+	set_le32( vgm + 0x04, sizeof vgm - 4 );
+	set_le32( vgm + 0x08, 0x101 );
+	set_le32( vgm + 0x10, 3546893 ); // YM2413 clock
+	set_le32( vgm + 0x18, 44100 ); // length
+	set_le32( vgm + 0x24, 50 );
+	memcpy( vgm + 0x40, cmds, sizeof cmds );
+}
+
+static void play_pal()
+{
+	Music_Emu* pal;
+	handle_error( gme_open_data( vgm, sizeof vgm, &pal, 44100 ) );
+	handle_error( gme_start_track( pal, 0 ) );
+	short buf [1024];
+	handle_error( gme_play( pal, 1024, buf ) );
+	gme_delete( pal );
+}
+
+// Renders one second of the NSF and returns a checksum of it. If open_pal is
+// set, the PAL VGM is played on another thread from halfway through.
+static unsigned long render_nsf( bool open_pal )
+{
+	Music_Emu* emu;
+	handle_error( gme_open_data( nsf, sizeof nsf, &emu, 44100 ) );
+	handle_error( gme_start_track( emu, 0 ) );
+
+	std::thread pal;
+	unsigned long sum = 0;
+	int nonzero = 0;
+	for ( int n = 0; n < 88200 / 1024; n++ )
+	{
+		if ( open_pal && n == 88200 / 1024 / 2 )
+			pal = std::thread( play_pal );
+
+		short buf [1024];
+		handle_error( gme_play( emu, 1024, buf ) );
+		for ( int i = 0; i < 1024; i++ )
+		{
+			sum = sum * 31 + (unsigned short) buf [i];
+			nonzero |= buf [i];
+		}
+	}
+	if ( pal.joinable() )
+		pal.join();
+	gme_delete( emu );
+
+	if ( !nonzero )
+		handle_error( "VRC7 test NSF is silent" );
+	return sum;
+}
+
+int main()
+{
+	make_nsf();
+	make_vgm();
+
+	if ( render_nsf( false ) != render_nsf( true ) )
+	{
+		fprintf( stderr, "VRC7 output changed after opening a PAL YM2413 VGM\n" );
+		return EXIT_FAILURE;
+	}
+	return 0;
+}
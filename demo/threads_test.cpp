@@ -0,0 +1,203 @@
+// Exercises the parts of the library meant to be used from several threads:
+// controls posted from another thread during play, a full control queue, and
+// a Music_Stream switching to a queued track, starting a silent track, and
+// where a stream's track ends when it fades into silence. Run under
+// -fsanitize=thread to check them for data races.
+
+// Usage: gme_threads_test [file.nsf]
+
+#include "gme/gme.h"
+#include "gme/Music_Emu.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+static void handle_error( const char* str )
+{
+	if ( str )
+	{
+		fprintf( stderr, "Error: %s\n", str );
+		exit( EXIT_FAILURE );
+	}
+}
+
+static void expect( bool ok, const char* what )
+{
+	if ( !ok )
+		handle_error( what );
+}
+
+static const char* path = "test.nsf";
+
+static Music_Emu* open_track( int track )
+{
+	Music_Emu* emu;
+	handle_error( gme_open_file( path, &emu, 44100 ) );
+	handle_error( gme_start_track( emu, track ) );
+	return emu;
+}
+
+// Plays while another thread keeps posting changes
+static void post_during_play()
+{
+	Music_Emu* emu = open_track( 0 );
+
+	std::atomic<bool> done( false );
+	std::atomic<int> posted( 0 );
+	std::thread poster( [&] {
+		gme_equalizer_t eq;
+		gme_equalizer( emu, &eq );
+		for ( int n = 0; !done.load(); n++ )
+		{
+			// a full queue is expected now and then
+			if ( !gme_post_mute_voices( emu, n & 3 ) )
+				posted++;
+			gme_post_tempo( emu, (n & 1) ? 1.5 : 1.0 );
+			eq.treble = -(n % 20);
+			gme_post_equalizer( emu, &eq );
+			std::this_thread::yield();
+		}
+	} );
+
+	for ( int n = 0; n < 200 || !posted.load(); n++ )
+	{
+		short buf [1024];
+		handle_error( gme_play( emu, 1024, buf ) );
+	}
+	done = true;
+	poster.join();
+
+	gme_delete( emu );
+}
+
+// Posts one more change than the queue holds
+static void fill_control_queue()
+{
+	Music_Emu* emu = open_track( 0 );
+
+	int const capacity = 32;
+	for ( int n = 0; n < capacity; n++ )
+		handle_error( gme_post_mute_voices( emu, n & 1 ) );
+	expect( gme_post_mute_voices( emu, 0 ) != NULL, "Full control queue accepted a change" );
+
+	// playing applies and frees them
+	short buf [1024];
+	handle_error( gme_play( emu, 1024, buf ) );
+	handle_error( gme_post_mute_voices( emu, 0 ) );
+
+	gme_delete( emu );
+}
+
+// Streams a track that fades out quickly, followed by a queued one
+static void stream_queued_track()
+{
+	Music_Emu* first = open_track( 0 );
+	gme_set_fade_msecs( first, 1000, 500 );
+
+	Music_Emu* next;
+	handle_error( gme_open_file( path, &next, 44100 ) );
+	handle_error( gme_post_fade_msecs( next, 1000, 500 ) );
+
+	Music_Stream* stream;
+	handle_error( gme_stream_new( first, 8192, &stream ) );
+	handle_error( gme_stream_queue_track( stream, next, 0, 0 ) );
+	expect( gme_stream_queued( stream ) != 0, "Track wasn't queued" );
+
+	// both tracks are about 1.5 seconds plus silence; give up long after
+	long read = 0;
+	long read_when_switched = -1;
+	std::chrono::steady_clock::time_point const give_up =
+			std::chrono::steady_clock::now() + std::chrono::seconds( 60 );
+	while ( !gme_stream_ended( stream ) )
+	{
+		expect( std::chrono::steady_clock::now() < give_up, "Stream never ended" );
+
+		short buf [1024];
+		int count = gme_stream_read( stream, 1024, buf );
+		read += count;
+		if ( read_when_switched < 0 && !gme_stream_queued( stream ) )
+			read_when_switched = read;
+		if ( !count )
+			std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+	}
+	handle_error( gme_stream_error( stream ) );
+	gme_stream_delete( stream );
+
+	expect( read_when_switched >= 0, "Queued track never started" );
+	expect( read - read_when_switched >= 44100 * 2, "Queued track was cut short" );
+
+	gme_delete( first );
+	gme_delete( next );
+}
+
+// Starts a track that's silent for longer than the initial silence search
+static void start_silent_track()
+{
+	Music_Emu* emu;
+	handle_error( gme_open_file( path, &emu, 44100 ) );
+	gme_mute_voices( emu, -1 );
+	handle_error( gme_start_track( emu, 0 ) );
+	expect( emu->track_ready(), "Search for initial silence didn't finish" );
+
+	gme_delete( emu );
+}
+
+// Streams a track that goes silent, which ends it after the silence limit, then
+// checks that its end is where the silence began, so a queued track would be
+// spliced in there rather than after the silence that detected the end
+static void stream_into_silence()
+{
+	Music_Emu* emu = open_track( 0 );
+
+	Music_Stream* stream;
+	handle_error( gme_stream_new( emu, 8192, &stream ) );
+
+	std::vector<short> out;
+	bool muted = false;
+	std::chrono::steady_clock::time_point const give_up =
+			std::chrono::steady_clock::now() + std::chrono::seconds( 60 );
+	while ( !gme_stream_ended( stream ) )
+	{
+		expect( std::chrono::steady_clock::now() < give_up, "Silence never ended track" );
+
+		// silence everything after half a second
+		if ( !muted && out.size() >= 44100 )
+			muted = !gme_post_mute_voices( emu, -1 );
+
+		short buf [1024];
+		int count = gme_stream_read( stream, 1024, buf );
+		out.insert( out.end(), buf, buf + count );
+		if ( !count )
+			std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+	}
+	handle_error( gme_stream_error( stream ) );
+	gme_stream_delete( stream );
+
+	// same threshold Music_Emu uses to detect silence
+	long sound_end = (long) out.size();
+	while ( sound_end && out [sound_end - 1] >= -8 && out [sound_end - 1] <= 8 )
+		sound_end--;
+	sound_end += sound_end & 1;
+
+	expect( out.size() - sound_end >= 44100 * 2, "Track ended before silence limit" );
+	expect( emu->track_end_samples() == sound_end, "Track end isn't where silence began" );
+
+	gme_delete( emu );
+}
+
+int main( int argc, char** argv )
+{
+	if ( argc >= 2 )
+		path = argv [1];
+
+	post_during_play();
+	fill_control_queue();
+	stream_queued_track();
+	start_silent_track();
+	stream_into_silence();
+	return 0;
+}
@@ -28,6 +28,10 @@ public:
 	void set_time( cpu_time_t t )       { state->time = t - state->base; }
 	void adjust_time( int delta )       { state->time += delta; }
 
+	// Number of clocks spent in idle loops and HALT that were skipped rather
+	// than emulated
+	int64_t skipped_clocks() const { return skipped_clocks_; }
+
 	#if BLARGG_BIG_ENDIAN
 		struct regs_t { uint8_t b, c, d, e, h, l, flags, a; };
 	#else
@@ -65,9 +69,9 @@ public:
 public:
 	Ay_Cpu();
 private:
-	uint8_t szpc [0x200];
 	uint8_t* mem;
 	cpu_time_t end_time_;
+	int64_t skipped_clocks_;
 	struct state_t {
 		cpu_time_t base;
 		cpu_time_t time;
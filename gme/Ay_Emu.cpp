@@ -301,6 +301,7 @@ void Ay_Emu::cpu_out_misc( cpu_time_t time, unsigned addr, int data )
 
 		case 0xBEFD:
 			spectrum_mode = true;
+			count_apu_write();
 			apu.write( time, apu_addr, data );
 			return;
 		}
@@ -318,6 +319,7 @@ void Ay_Emu::cpu_out_misc( cpu_time_t time, unsigned addr, int data )
 				goto enable_cpc;
 
 			case 0x80:
+				count_apu_write();
 				apu.write( time, apu_addr, cpc_latch );
 				goto enable_cpc;
 			}
@@ -374,6 +376,11 @@ int ay_cpu_in( Ay_Cpu*, unsigned addr )
 	return 0xFF;
 }
 
+int64_t Ay_Emu::idle_clocks_() const
+{
+	return cpu::skipped_clocks();
+}
+
 blargg_err_t Ay_Emu::run_clocks( blip_time_t& duration, int )
 {
 	set_time( 0 );
@@ -38,6 +38,9 @@ Blip_Buffer::Blip_Buffer()
 	clock_rate_   = 0;
 	bass_freq_    = 16;
 	length_       = 0;
+	deltas_pending_ = 0;
+	non_silence_  = 0;
+	external_buffer_ = false;
 
 	// assumptions code makes about implementation-defined features
 	#ifndef NDEBUG
@@ -53,7 +56,7 @@ Blip_Buffer::Blip_Buffer()
 
 Blip_Buffer::~Blip_Buffer()
 {
-	if ( buffer_size_ != silent_buf_size )
+	if ( buffer_size_ != silent_buf_size && !external_buffer_ )
 		free( buffer_ );
 }
 
@@ -70,6 +73,9 @@ void Blip_Buffer::clear( int entire_buffer )
 	offset_      = 0;
 	reader_accum_ = 0;
 	modified_    = 0;
+	non_silence_ = 0;
+	if ( entire_buffer )
+		deltas_pending_ = 0;
 	if ( buffer_ )
 	{
 		long count = (entire_buffer ? buffer_size_ : samples_avail());
@@ -77,14 +83,8 @@ void Blip_Buffer::clear( int entire_buffer )
 	}
 }
 
-Blip_Buffer::blargg_err_t Blip_Buffer::set_sample_rate( long new_rate, int msec )
+long Blip_Buffer::storage_size( long new_rate, int msec )
 {
-	if ( buffer_size_ == silent_buf_size )
-	{
-		assert( 0 );
-		return "Internal (tried to resize Silent_Blip_Buffer)";
-	}
-
 	// start with maximum length that resampled time can represent
 	long new_size = (UINT_MAX >> BLIP_BUFFER_ACCURACY) - blip_buffer_extra_ - 64;
 	if ( msec != blip_max_length )
@@ -95,15 +95,49 @@ Blip_Buffer::blargg_err_t Blip_Buffer::set_sample_rate( long new_rate, int msec
 		else
 			assert( 0 ); // fails if requested buffer length exceeds limit
 	}
+	return new_size + blip_buffer_extra_;
+}
 
-	if ( buffer_size_ != new_size )
+Blip_Buffer::blargg_err_t Blip_Buffer::set_sample_rate( long new_rate, int msec )
+{
+	if ( buffer_size_ == silent_buf_size )
+	{
+		assert( 0 );
+		return "Internal (tried to resize Silent_Blip_Buffer)";
+	}
+
+	long new_size = storage_size( new_rate, msec ) - blip_buffer_extra_;
+	if ( buffer_size_ != new_size || external_buffer_ )
 	{
-		void* p = realloc( buffer_, (new_size + blip_buffer_extra_) * sizeof *buffer_ );
+		void* p = realloc( external_buffer_ ? 0 : buffer_,
+				(new_size + blip_buffer_extra_) * sizeof *buffer_ );
 		if ( !p )
 			return "Out of memory";
 		buffer_ = (buf_t_*) p;
+		external_buffer_ = false;
 	}
 
+	return buffer_resized( new_rate, new_size, msec );
+}
+
+Blip_Buffer::blargg_err_t Blip_Buffer::set_sample_rate( long new_rate, int msec, buf_t_* storage )
+{
+	if ( buffer_size_ == silent_buf_size )
+	{
+		assert( 0 );
+		return "Internal (tried to resize Silent_Blip_Buffer)";
+	}
+
+	if ( !external_buffer_ )
+		free( buffer_ );
+	buffer_ = storage;
+	external_buffer_ = true;
+
+	return buffer_resized( new_rate, storage_size( new_rate, msec ) - blip_buffer_extra_, msec );
+}
+
+Blip_Buffer::blargg_err_t Blip_Buffer::buffer_resized( long new_rate, long new_size, int msec )
+{
 	buffer_size_ = new_size;
 	assert( buffer_size_ != silent_buf_size );
 
@@ -146,12 +180,22 @@ void Blip_Buffer::end_frame( blip_time_t t )
 {
 	offset_ += t * factor_;
 	assert( samples_avail() <= (long) buffer_size_ ); // time outside buffer length
+
+	if ( deltas_pending_ )
+	{
+		deltas_pending_ = 0;
+		long n = samples_avail() + blip_buffer_extra_;
+		if ( non_silence_ < n )
+			non_silence_ = n;
+	}
 }
 
 void Blip_Buffer::remove_silence( long count )
 {
 	assert( count <= samples_avail() ); // tried to remove more samples than available
 	offset_ -= (blip_resampled_time_t) count << BLIP_BUFFER_ACCURACY;
+	if ( (non_silence_ -= count) < 0 )
+		non_silence_ = 0;
 }
 
 long Blip_Buffer::count_samples( blip_time_t t ) const
@@ -179,7 +223,11 @@ void Blip_Buffer::remove_samples( long count )
 {
 	if ( count )
 	{
+		// nothing to move if buffer is all zero
+		bool const was_silent = !non_silence_ && !deltas_pending_;
 		remove_silence( count );
+		if ( was_silent )
+			return;
 
 		// copy remaining samples to beginning and clear old samples
 		long remain = samples_avail() + blip_buffer_extra_;
@@ -446,6 +494,9 @@ void Blip_Buffer::mix_samples( blip_sample_t const* in, long count )
 	}
 
 	buf_t_* out = buffer_ + (offset_ >> BLIP_BUFFER_ACCURACY) + blip_widest_impulse_ / 2;
+	long end = (long) (out - buffer_) + count + 1;
+	if ( non_silence_ < end )
+		non_silence_ = end;
 
 	int const sample_shift = blip_sample_bits - 16;
 	int prev = 0;
@@ -86,6 +86,9 @@ public:
 	// not documented yet
 	void set_modified() { modified_ = 1; }
 	int clear_modified() { int b = modified_; modified_ = 0; return b; }
+	// True unless buffer holds only silence and its output has settled, in which
+	// case mixers can skip reading it and use remove_silence() instead
+	int non_silent() const;
 	typedef blip_ulong blip_resampled_time_t;
 	void remove_silence( long count );
 	blip_resampled_time_t resampled_duration( int t ) const     { return t * factor_; }
@@ -105,18 +108,31 @@ private:
 	Blip_Buffer& operator = ( const Blip_Buffer& );
 public:
 	typedef blip_time_t buf_t_;
+
+	// Number of buf_t_ elements a buffer with given sample rate and length uses
+	static long storage_size( long samples_per_sec, int msec_length );
+
+	// Same as set_sample_rate(), but uses caller-owned storage of at least
+	// storage_size() elements rather than allocating its own. Storage must stay
+	// valid until the next set_sample_rate() or destruction.
+	blargg_err_t set_sample_rate( long samples_per_sec, int msec_length, buf_t_* storage );
+
 	blip_ulong factor_;
 	blip_resampled_time_t offset_;
 	buf_t_* buffer_;
 	blip_long buffer_size_;
 	blip_long reader_accum_;
 	int bass_shift_;
+	int deltas_pending_;  // set by synths; deltas added since last end_frame()
+	long non_silence_;    // number of samples from read position that may be non-zero
 private:
 	long sample_rate_;
 	long clock_rate_;
 	int bass_freq_;
 	int length_;
 	int modified_;
+	bool external_buffer_;
+	blargg_err_t buffer_resized( long new_rate, long new_size, int msec );
 	friend class Blip_Reader;
 };
 
@@ -346,6 +362,7 @@ inline void Blip_Synth<quality,range>::offset_resampled( blip_resampled_time_t t
 	// Fails if time is beyond end of Blip_Buffer, due to a bug in caller code or the
 	// need for a longer buffer as set by set_sample_rate().
 	assert( (blip_long) (time >> BLIP_BUFFER_ACCURACY) < blip_buf->buffer_size_ );
+	blip_buf->deltas_pending_ = 1;
 	delta *= impl.delta_factor;
 	blip_long* BLIP_RESTRICT buf = blip_buf->buffer_ + (time >> BLIP_BUFFER_ACCURACY);
 	int phase = (int) (time >> (BLIP_BUFFER_ACCURACY - BLIP_PHASE_BITS) & (blip_res - 1));
@@ -481,6 +498,13 @@ inline long Blip_Buffer::samples_avail() const
     return samples <= (long) buffer_size_ ? samples : 0;
 }
 
+inline int Blip_Buffer::non_silent() const
+{
+	// accumulator below this neither decays nor reaches the output
+	int const shift = bass_shift_ < blip_sample_bits - 16 ? bass_shift_ : blip_sample_bits - 16;
+	return (non_silence_ | deltas_pending_ | ((blip_ulong) reader_accum_ >> shift)) != 0;
+}
+
 inline long Blip_Buffer::sample_rate() const    { return sample_rate_; }
 inline int  Blip_Buffer::output_latency() const { return blip_widest_impulse_ / 2; }
 inline long Blip_Buffer::clock_rate() const     { return clock_rate_; }
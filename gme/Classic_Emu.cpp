@@ -106,7 +106,10 @@ blargg_err_t Classic_Emu::play_( long count, sample_t* out )
 	long remain = count;
 	while ( remain )
 	{
-		remain -= buf->read_samples( &out [count - remain], remain );
+		{
+			Emu_Stats_Timer timer( emu_stats(), emu_stats().counts.mix_nsec );
+			remain -= buf->read_samples( &out [count - remain], remain );
+		}
 		if ( remain )
 		{
 			if ( buf_changed_count != buf->channels_changed_count() )
@@ -118,6 +121,7 @@ blargg_err_t Classic_Emu::play_( long count, sample_t* out )
 			blip_time_t clocks_emulated = (int32_t) msec * clock_rate_ / 1000;
 			RETURN_ERR( run_clocks( clocks_emulated, msec ) );
 			assert( clocks_emulated );
+			emu_stats().counts.cpu_clocks += clocks_emulated;
 			buf->end_frame( clocks_emulated );
 		}
 	}
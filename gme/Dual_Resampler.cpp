@@ -53,7 +53,7 @@ void Dual_Resampler::resize( int pairs )
 	}
 }
 
-void Dual_Resampler::play_frame_( Blip_Buffer& blip_buf, dsample_t* out )
+void Dual_Resampler::play_frame_( Blip_Buffer& blip_buf, dsample_t* out, Emu_Stats& stats )
 {
 	long pair_count = sample_buf_size >> 1;
 	blip_time_t blip_time = blip_buf.count_clocks( pair_count );
@@ -67,18 +67,25 @@ void Dual_Resampler::play_frame_( Blip_Buffer& blip_buf, dsample_t* out )
 
 	resampler.write( new_count );
 
-#ifdef	NDEBUG // Avoid warning when asserts are disabled
-	resampler.read( sample_buf.begin(), sample_buf_size );
-#else
-	long count = resampler.read( sample_buf.begin(), sample_buf_size );
-	assert( count == (long) sample_buf_size );
-#endif
+	{
+		Emu_Stats_Timer timer( stats, stats.counts.resample_nsec );
+	#ifdef	NDEBUG // Avoid warning when asserts are disabled
+		resampler.read( sample_buf.begin(), sample_buf_size );
+	#else
+		long count = resampler.read( sample_buf.begin(), sample_buf_size );
+		assert( count == (long) sample_buf_size );
+	#endif
+		stats.counts.samples_resampled += sample_buf_size;
+	}
 
-	mix_samples( blip_buf, out );
-	blip_buf.remove_samples( pair_count );
+	{
+		Emu_Stats_Timer timer( stats, stats.counts.mix_nsec );
+		mix_samples( blip_buf, out );
+		blip_buf.remove_samples( pair_count );
+	}
 }
 
-void Dual_Resampler::dual_play( long count, dsample_t* out, Blip_Buffer& blip_buf )
+void Dual_Resampler::dual_play( long count, dsample_t* out, Blip_Buffer& blip_buf, Emu_Stats& stats )
 {
 	// empty extra buffer
 	long remain = sample_buf_size - buf_pos;
@@ -95,7 +102,7 @@ void Dual_Resampler::dual_play( long count, dsample_t* out, Blip_Buffer& blip_bu
 	// entire frames
 	while ( count >= (long) sample_buf_size )
 	{
-		play_frame_( blip_buf, out );
+		play_frame_( blip_buf, out, stats );
 		out += sample_buf_size;
 		count -= sample_buf_size;
 	}
@@ -103,7 +110,7 @@ void Dual_Resampler::dual_play( long count, dsample_t* out, Blip_Buffer& blip_bu
 	// extra
 	if ( count )
 	{
-		play_frame_( blip_buf, sample_buf.begin() );
+		play_frame_( blip_buf, sample_buf.begin(), stats );
 		buf_pos = count;
 		blarg_memcpy( out, sample_buf.begin(), count * sizeof *out );
 		out += count;
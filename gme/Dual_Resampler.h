@@ -6,6 +6,7 @@
 
 #include "Fir_Resampler.h"
 #include "Blip_Buffer.h"
+#include "Emu_Stats.h"
 
 class Dual_Resampler {
 public:
@@ -15,11 +16,15 @@ public:
 	typedef short dsample_t;
 
 	double setup( double oversample, double rolloff, double gain );
+
+	// Use a narrower, faster resampling filter if draft is true. Takes effect at
+	// next setup().
+	void draft_resampling( bool draft );
 	blargg_err_t reset( int max_pairs );
 	void resize( int pairs_per_frame );
 	void clear();
 
-	void dual_play( long count, dsample_t* out, Blip_Buffer& );
+	void dual_play( long count, dsample_t* out, Blip_Buffer&, Emu_Stats& );
 
 protected:
 	virtual int play_frame( blip_time_t, int pcm_count, dsample_t* pcm_out ) = 0;
@@ -31,9 +36,10 @@ private:
 	int buf_pos;
 	int resampler_size;
 
-	Fir_Resampler<12> resampler;
+	enum { resampler_width = 12, draft_resampler_width = 4 };
+	Fir_Resampler<resampler_width> resampler;
 	void mix_samples( Blip_Buffer&, dsample_t* );
-	void play_frame_( Blip_Buffer&, dsample_t* );
+	void play_frame_( Blip_Buffer&, dsample_t*, Emu_Stats& );
 };
 
 inline double Dual_Resampler::setup( double oversample, double rolloff, double gain )
@@ -41,6 +47,11 @@ inline double Dual_Resampler::setup( double oversample, double rolloff, double g
 	return resampler.time_ratio( oversample, rolloff, gain * 0.5 );
 }
 
+inline void Dual_Resampler::draft_resampling( bool draft )
+{
+	resampler.set_width( draft ? draft_resampler_width : resampler_width );
+}
+
 inline void Dual_Resampler::clear()
 {
 	buf_pos = sample_buf_size;
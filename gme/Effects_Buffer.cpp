@@ -2,6 +2,7 @@
 
 #include "Effects_Buffer.h"
 
+#include "blargg_simd.h"
 #include <string.h>
 //#include <algorithm>
 
@@ -46,6 +47,11 @@ const unsigned reverb_size = 8192 * 2;
 const unsigned reverb_mask = reverb_size - 1;
 BOOST_STATIC_ASSERT( (reverb_size & reverb_mask) == 0 , "reverb_size must be a power of 2"); // must be power of 2
 
+// each block in the arena starts on its own cache line
+const size_t arena_align = 64;
+
+inline size_t arena_round( size_t n ) { return (n + arena_align - 1) & ~(arena_align - 1); }
+
 Effects_Buffer::config_t::config_t()
 {
 	pan_1           = -0.15f;
@@ -85,11 +91,19 @@ Effects_Buffer::Effects_Buffer( int num_voices, bool center_only )
 	// TODO: Reorder buf_count to be initialized before bufs to factor out channel sizing
 	, buf_count(max_voices * (center_only ? (max_buf_count - 4) : max_buf_count))
 	, effects_enabled(false)
-	, reverb_buf(max_voices, BlipSampleVector(reverb_size))
-	, echo_buf(max_voices, BlipSampleVector(echo_size))
-	, reverb_pos(max_voices)
-	, echo_pos(max_voices)
+	, fx_simd(false)
+	, fx(max_voices)
 {
+	for ( int i = 0; i < max_voices; i++ )
+	{
+		fx [i].reverb_buf = 0;
+		fx [i].echo_buf   = 0;
+		fx [i].reverb_pos = 0;
+		fx [i].echo_pos   = 0;
+		fx [i].silent      = false;
+		fx [i].fx_silent   = false;
+		fx [i].quiet_count = 0;
+	}
 	set_depth( 0 );
 }
 
@@ -98,27 +112,30 @@ Effects_Buffer::~Effects_Buffer()
 
 blargg_err_t Effects_Buffer::set_sample_rate( long rate, int msec ) noexcept
 {
-	for(int i=0; i<max_voices; i++)
+	int const bufs_per_voice = buf_count / max_voices;
+	size_t const buf_size = arena_round( Blip_Buffer::storage_size( rate, msec ) *
+			sizeof (Blip_Buffer::buf_t_) );
+	size_t const reverb_bytes = arena_round( reverb_size * sizeof (blip_sample_t) );
+	size_t const echo_bytes   = arena_round( echo_size   * sizeof (blip_sample_t) );
+	size_t const voice_size = bufs_per_voice * buf_size + reverb_bytes + echo_bytes;
+	RETURN_ERR( arena.resize( max_voices * voice_size + arena_align - 1 ) );
+
+	char* p = arena.begin();
+	p += (arena_align - (size_t) p % arena_align) % arena_align;
+	for ( int v = 0; v < max_voices; v++ )
 	{
-		if ( !echo_buf[i].size() )
-		{
-			echo_buf[i].resize( echo_size );
-		}
-
-		if ( !reverb_buf[i].size() )
+		for ( int i = 0; i < bufs_per_voice; i++ )
 		{
-			reverb_buf[i].resize( reverb_size );
-		}
-
-		if ( !echo_buf[i].size() || !reverb_buf[i].size() )
-		{
-			return "Out of memory";
+			RETURN_ERR( bufs [v * bufs_per_voice + i].set_sample_rate( rate, msec,
+					(Blip_Buffer::buf_t_*) p ) );
+			p += buf_size;
 		}
+		fx [v].reverb_buf = (blip_sample_t*) p;
+		p += reverb_bytes;
+		fx [v].echo_buf = (blip_sample_t*) p;
+		p += echo_bytes;
 	}
 
-	for ( int i = 0; i < buf_count; i++ )
-		RETURN_ERR( bufs [i].set_sample_rate( rate, msec ) );
-
 	config( config_ );
 	clear();
 
@@ -144,13 +161,14 @@ void Effects_Buffer::clear()
 	stereo_remain = 0;
 	effect_remain = 0;
 
-	for(i=0; i<max_voices; i++)
+	if ( arena.size() )
 	{
-		if ( echo_buf[i].size() )
-			blarg_memset( &echo_buf[i][0], 0, echo_size * sizeof echo_buf[i][0] );
-
-		if ( reverb_buf[i].size() )
-			blarg_memset( &reverb_buf[i][0], 0, reverb_size * sizeof reverb_buf[i][0] );
+		for ( i = 0; i < max_voices; i++ )
+		{
+			blarg_memset( fx [i].reverb_buf, 0, reverb_size * sizeof (blip_sample_t) );
+			blarg_memset( fx [i].echo_buf, 0, echo_size * sizeof (blip_sample_t) );
+			fx [i].fx_silent = true;
+		}
 	}
 
 	for (i = 0; i < buf_count; i++ )
@@ -173,12 +191,13 @@ void Effects_Buffer::config( const config_t& cfg )
 	// clear echo and reverb buffers
 	// ensure the echo/reverb buffers have already been allocated, so this method can be
 	// called before set_sample_rate is called
-	if ( !config_.effects_enabled && cfg.effects_enabled && echo_buf[0].size() )
+	if ( !config_.effects_enabled && cfg.effects_enabled && arena.size() )
 	{
 		for(int i=0; i<max_voices; i++)
 		{
-			blarg_memset( &echo_buf[i][0], 0, echo_size * sizeof echo_buf[i][0] );
-			blarg_memset( &reverb_buf[i][0], 0, reverb_size * sizeof reverb_buf[i][0] );
+			blarg_memset( fx [i].echo_buf, 0, echo_size * sizeof (blip_sample_t) );
+			blarg_memset( fx [i].reverb_buf, 0, reverb_size * sizeof (blip_sample_t) );
+			fx [i].fx_silent = true;
 		}
 	}
 
@@ -197,6 +216,18 @@ void Effects_Buffer::config( const config_t& cfg )
 		chans.reverb_level = TO_FIXED( config_.reverb_level );
 		chans.echo_level = TO_FIXED( config_.echo_level );
 
+		// vector mixing computes products in 16-bit pieces
+		fx_simd = true;
+		for ( int i = 0; i < 2; i++ )
+		{
+			if ( (unsigned long) chans.pan_1_levels [i] > 0x10000 ||
+					(unsigned long) chans.pan_2_levels [i] > 0x10000 )
+				fx_simd = false;
+		}
+		if ( (unsigned long) chans.reverb_level > 0x7FFF ||
+				(unsigned long) chans.echo_level > 0x7FFF )
+			fx_simd = false;
+
 		int delay_offset = int (1.0 / 2000 * config_.delay_variance * sample_rate());
 
 		int reverb_sample_delay = int (1.0 / 1000 * config_.reverb_delay * sample_rate());
@@ -316,6 +347,8 @@ long Effects_Buffer::read_samples( blip_sample_t* out, long total_samples )
 		int active_bufs = buf_count_per_voice;
 		long count = remain;
 
+		update_silence();
+
 		// optimizing mixing to skip any channels which had nothing added
 		if ( effect_remain )
 		{
@@ -324,11 +357,11 @@ long Effects_Buffer::read_samples( blip_sample_t* out, long total_samples )
 
 			if ( stereo_remain )
 			{
-				mix_enhanced( out, count );
+				mix_effects( out, count, true );
 			}
 			else
 			{
-				mix_mono_enhanced( out, count );
+				mix_effects( out, count, false );
 				active_bufs = 3;
 			}
 		}
@@ -361,7 +394,7 @@ long Effects_Buffer::read_samples( blip_sample_t* out, long total_samples )
 		{
 			for ( int i = 0; i < buf_count_per_voice; i++) // foreach buffer of that voice
 			{
-				if ( i < active_bufs )
+				if ( i < active_bufs && !fx [v].silent )
 					bufs [v*buf_count_per_voice + i].remove_samples( count );
 				else // keep time synchronized
 					bufs [v*buf_count_per_voice + i].remove_silence( count );
@@ -372,10 +405,77 @@ long Effects_Buffer::read_samples( blip_sample_t* out, long total_samples )
 	return total_samples * n_channels;
 }
 
+void Effects_Buffer::update_silence()
+{
+	const int buf_count_per_voice = buf_count/max_voices;
+	for ( int v = 0; v < max_voices; v++ )
+	{
+		bool silent = true;
+		for ( int i = 0; i < buf_count_per_voice; i++ )
+		{
+			if ( bufs [v*buf_count_per_voice + i].non_silent() )
+			{
+				silent = false;
+				break;
+			}
+		}
+
+		fx [v].silent = silent;
+		if ( !silent )
+		{
+			fx [v].fx_silent = false;
+			fx [v].quiet_count = 0;
+		}
+	}
+}
+
+// A silent voice with settled echo and reverb contributes nothing, so its
+// output slots are just cleared
+void Effects_Buffer::skip_voice( blip_sample_t* out_, int32_t count, int i )
+{
+	blip_sample_t* BLIP_RESTRICT out = out_ + i*2;
+	while ( count-- )
+	{
+		out [0] = 0;
+		out [1] = 0;
+		out += max_voices*2;
+	}
+}
+
+// Called after mixing a voice that had no input. Echo has died out after
+// echo_size frames, but reverb can settle on small non-zero values, so the
+// lines are checked rather than assumed clear. Checking every echo_size frames
+// costs far less than mixing them.
+void Effects_Buffer::fx_settled( int i, int32_t count )
+{
+	long prev = fx [i].quiet_count;
+	fx [i].quiet_count += count;
+	if ( prev / echo_size == fx [i].quiet_count / echo_size )
+		return;
+
+	blip_sample_t const* p = fx [i].reverb_buf;
+	for ( unsigned n = reverb_size; n; --n )
+		if ( *p++ )
+			return;
+
+	p = fx [i].echo_buf;
+	for ( unsigned n = echo_size; n; --n )
+		if ( *p++ )
+			return;
+
+	fx [i].fx_silent = true;
+}
+
 void Effects_Buffer::mix_mono( blip_sample_t* out_, int32_t count )
 {
     for(int i=0; i<max_voices; i++)
     {
+	if ( fx [i].silent )
+	{
+		skip_voice( out_, count, i );
+		continue;
+	}
+
 	blip_sample_t* BLIP_RESTRICT out = out_;
 	int const bass = BLIP_READER_BASS( bufs [i*max_buf_count+0] );
 	BLIP_READER_BEGIN( c, bufs [i*max_buf_count+0] );
@@ -417,6 +517,12 @@ void Effects_Buffer::mix_stereo( blip_sample_t* out_, int32_t frames )
 {
     for(int i=0; i<max_voices; i++)
     {
+	if ( fx [i].silent )
+	{
+		skip_voice( out_, frames, i );
+		continue;
+	}
+
 	blip_sample_t* BLIP_RESTRICT out = out_;
 	int const bass = BLIP_READER_BASS( bufs [i*max_buf_count+0] );
 	BLIP_READER_BEGIN( c, bufs [i*max_buf_count+0] );
@@ -452,152 +558,342 @@ void Effects_Buffer::mix_stereo( blip_sample_t* out_, int32_t frames )
     }
 }
 
-void Effects_Buffer::mix_mono_enhanced( blip_sample_t* out_, int32_t frames )
+// Echo and reverb are mixed in blocks. Blip_Buffer integration is serial, so
+// each buffer's samples for the block are read into an array first, then the
+// pan, echo and reverb arithmetic runs over the whole block, several frames at
+// a time where the instruction set allows.
+
+int const fx_block_size = 256;
+
+struct fx_block_t
 {
-	for(int i=0; i<max_voices; i++)
-	{
-	blip_sample_t* BLIP_RESTRICT out = out_;
-	int const bass = BLIP_READER_BASS( bufs [i*max_buf_count+2] );
-	BLIP_READER_BEGIN( center, bufs [i*max_buf_count+2] );
-	BLIP_READER_BEGIN( sq1, bufs [i*max_buf_count+0] );
-	BLIP_READER_BEGIN( sq2, bufs [i*max_buf_count+1] );
+	int sq1    [fx_block_size];
+	int sq2    [fx_block_size];
+	int l1     [fx_block_size];
+	int r1     [fx_block_size];
+	int l2     [fx_block_size];
+	int r2     [fx_block_size];
+	int center [fx_block_size];
+	blip_sample_t out [fx_block_size * 2];
+};
+
+// Copy of one voice's effect state. Levels are long to match the arithmetic
+// of Effects_Buffer::fixed_t exactly.
+struct fx_params_t
+{
+	blip_sample_t* reverb_buf;
+	blip_sample_t* echo_buf;
+	int reverb_pos;
+	int echo_pos;
+	long pan_1_levels [2];
+	long pan_2_levels [2];
+	long reverb_level;
+	long echo_level;
+	int reverb_delay_l;
+	int reverb_delay_r;
+	int echo_delay_l;
+	int echo_delay_r;
+};
+
+static inline void fx_frame( fx_params_t& p, fx_block_t& b, int k )
+{
+	blip_sample_t* const reverb_buf = p.reverb_buf;
+	blip_sample_t* const echo_buf = p.echo_buf;
+	int const reverb_pos = p.reverb_pos;
+	int const echo_pos = p.echo_pos;
 
-	blip_sample_t* const reverb_buf = &this->reverb_buf[i][0];
-	blip_sample_t* const echo_buf = &this->echo_buf[i][0];
-	int echo_pos = this->echo_pos[i];
-	int reverb_pos = this->reverb_pos[i];
+	int new_reverb_l = FMUL( b.sq1 [k], p.pan_1_levels [0] ) +
+			FMUL( b.sq2 [k], p.pan_2_levels [0] ) + b.l1 [k] +
+			reverb_buf [(reverb_pos + p.reverb_delay_l) & reverb_mask];
 
-	int count = frames;
-	while ( count-- )
-	{
-		int sum1_s = BLIP_READER_READ( sq1 );
-		int sum2_s = BLIP_READER_READ( sq2 );
+	int new_reverb_r = FMUL( b.sq1 [k], p.pan_1_levels [1] ) +
+			FMUL( b.sq2 [k], p.pan_2_levels [1] ) + b.r1 [k] +
+			reverb_buf [(reverb_pos + p.reverb_delay_r) & reverb_mask];
 
-		BLIP_READER_NEXT( sq1, bass );
-		BLIP_READER_NEXT( sq2, bass );
+	reverb_buf [reverb_pos] = (blip_sample_t) FMUL( new_reverb_l, p.reverb_level );
+	reverb_buf [reverb_pos + 1] = (blip_sample_t) FMUL( new_reverb_r, p.reverb_level );
+	p.reverb_pos = (reverb_pos + 2) & reverb_mask;
 
-		int new_reverb_l = FMUL( sum1_s, chans.pan_1_levels [0] ) +
-				FMUL( sum2_s, chans.pan_2_levels [0] ) +
-				reverb_buf [(reverb_pos + chans.reverb_delay_l) & reverb_mask];
+	int const sum3_s = b.center [k];
 
-		int new_reverb_r = FMUL( sum1_s, chans.pan_1_levels [1] ) +
-				FMUL( sum2_s, chans.pan_2_levels [1] ) +
-				reverb_buf [(reverb_pos + chans.reverb_delay_r) & reverb_mask];
+	int left = new_reverb_l + sum3_s + b.l2 [k] + FMUL( p.echo_level,
+			echo_buf [(echo_pos + p.echo_delay_l) & echo_mask] );
+	int right = new_reverb_r + sum3_s + b.r2 [k] + FMUL( p.echo_level,
+			echo_buf [(echo_pos + p.echo_delay_r) & echo_mask] );
 
-		fixed_t reverb_level = chans.reverb_level;
-		reverb_buf [reverb_pos] = (blip_sample_t) FMUL( new_reverb_l, reverb_level );
-		reverb_buf [reverb_pos + 1] = (blip_sample_t) FMUL( new_reverb_r, reverb_level );
-		reverb_pos = (reverb_pos + 2) & reverb_mask;
+	echo_buf [echo_pos] = sum3_s;
+	p.echo_pos = (echo_pos + 1) & echo_mask;
 
-		int sum3_s = BLIP_READER_READ( center );
-		BLIP_READER_NEXT( center, bass );
+	if ( (int16_t) left != left )
+		left = 0x7FFF - (left >> 24);
 
-		int left = new_reverb_l + sum3_s + FMUL( chans.echo_level,
-				echo_buf [(echo_pos + chans.echo_delay_l) & echo_mask] );
-		int right = new_reverb_r + sum3_s + FMUL( chans.echo_level,
-				echo_buf [(echo_pos + chans.echo_delay_r) & echo_mask] );
+	if ( (int16_t) right != right )
+		right = 0x7FFF - (right >> 24);
 
-		echo_buf [echo_pos] = sum3_s;
-		echo_pos = (echo_pos + 1) & echo_mask;
+	b.out [k * 2 + 0] = left;
+	b.out [k * 2 + 1] = right;
+}
 
-		if ( (int16_t) left != left )
-			left = 0x7FFF - (left >> 24);
+#if BLARGG_SIMD_SSE2
 
-		if ( (int16_t) right != right )
-			right = 0x7FFF - (right >> 24);
+// Number of frames from current positions that can be mixed with plain loads
+// and stores: no delay line may wrap, and no frame may read a delay line entry
+// an earlier frame of the span writes
+static int fx_span( fx_params_t const& p, int n )
+{
+	int const rl = (p.reverb_pos + p.reverb_delay_l) & reverb_mask; // even
+	int const rr = (p.reverb_pos + p.reverb_delay_r) & reverb_mask; // odd
+	int const el = (p.echo_pos + p.echo_delay_l) & echo_mask;
+	int const er = (p.echo_pos + p.echo_delay_r) & echo_mask;
+
+	n = min( n, (int) (reverb_size - p.reverb_pos) / 2 );
+	n = min( n, (int) (reverb_size - rl) / 2 );
+	n = min( n, (int) (reverb_size - rr + 1) / 2 );
+	n = min( n, (int) (echo_size - p.echo_pos) );
+	n = min( n, (int) (echo_size - el) );
+	n = min( n, (int) (echo_size - er) );
+
+	n = min( n, (int) (reverb_size - p.reverb_delay_l) / 2 );
+	n = min( n, (int) (reverb_size - p.reverb_delay_r) / 2 );
+	n = min( n, (int) (echo_size - p.echo_delay_l) );
+	n = min( n, (int) (echo_size - p.echo_delay_r) );
+	return n;
+}
 
-		out [i*2+0] = left;
-		out [i*2+1] = right;
-		out += max_voices*2;
-	}
-	this->reverb_pos[i] = reverb_pos;
-	this->echo_pos[i] = echo_pos;
+#endif
 
-	BLIP_READER_END( sq1, bufs [i*max_buf_count+0] );
-	BLIP_READER_END( sq2, bufs [i*max_buf_count+1] );
-	BLIP_READER_END( center, bufs [i*max_buf_count+2] );
-    }
+#if BLARGG_SIMD_SSE2
+
+// FMUL( s, level ) for s in 16-bit range and 0 <= level <= 0x10000, as
+// s * (level >> 15) + (s * (level & 0x7FFF) >> 15). Levels are stored with
+// the upper 16 bits clear, so pmaddwd gives exact products.
+static inline __m128i fx_pan_sse2( __m128i s, __m128i hi, __m128i lo )
+{
+	return _mm_add_epi32( _mm_madd_epi16( s, hi ), _mm_srai_epi32( _mm_madd_epi16( s, lo ), 15 ) );
 }
 
-void Effects_Buffer::mix_enhanced( blip_sample_t* out_, int32_t frames )
+// FMUL( v, level ) for v below 2^30 in magnitude and 0 <= level <= 0x7FFF,
+// with v split at bit 15 so both partial products fit pmaddwd
+static inline __m128i fx_level_sse2( __m128i v, __m128i level )
 {
-    for(int i=0; i<max_voices; i++)
-    {
-	blip_sample_t* BLIP_RESTRICT out = out_;
-	int const bass = BLIP_READER_BASS( bufs [i*max_buf_count+2] );
-	BLIP_READER_BEGIN( center, bufs [i*max_buf_count+2] );
-	BLIP_READER_BEGIN( l1, bufs [i*max_buf_count+3] );
-	BLIP_READER_BEGIN( r1, bufs [i*max_buf_count+4] );
-	BLIP_READER_BEGIN( l2, bufs [i*max_buf_count+5] );
-	BLIP_READER_BEGIN( r2, bufs [i*max_buf_count+6] );
-	BLIP_READER_BEGIN( sq1, bufs [i*max_buf_count+0] );
-	BLIP_READER_BEGIN( sq2, bufs [i*max_buf_count+1] );
-
-	blip_sample_t* const reverb_buf = &this->reverb_buf[i][0];
-	blip_sample_t* const echo_buf = &this->echo_buf[i][0];
-	int echo_pos = this->echo_pos[i];
-	int reverb_pos = this->reverb_pos[i];
+	__m128i q = _mm_srai_epi32( v, 15 );
+	__m128i r = _mm_and_si128( v, _mm_set1_epi32( 0x7FFF ) );
+	return _mm_add_epi32( _mm_madd_epi16( q, level ), _mm_srai_epi32( _mm_madd_epi16( r, level ), 15 ) );
+}
 
-	int count = frames;
-	while ( count-- )
+#define FX_LOAD( p ) _mm_loadu_si128( (__m128i const*) (p) )
+
+// Mixes n frames starting at k, four at a time. n must be a multiple of 4 and
+// within fx_span().
+static void fx_run_sse2( fx_params_t& p, fx_block_t& b, int k, int n )
+{
+	__m128i const p1l_hi = _mm_set1_epi32( (int) (p.pan_1_levels [0] >> 15) );
+	__m128i const p1l_lo = _mm_set1_epi32( (int) (p.pan_1_levels [0] & 0x7FFF) );
+	__m128i const p1r_hi = _mm_set1_epi32( (int) (p.pan_1_levels [1] >> 15) );
+	__m128i const p1r_lo = _mm_set1_epi32( (int) (p.pan_1_levels [1] & 0x7FFF) );
+	__m128i const p2l_hi = _mm_set1_epi32( (int) (p.pan_2_levels [0] >> 15) );
+	__m128i const p2l_lo = _mm_set1_epi32( (int) (p.pan_2_levels [0] & 0x7FFF) );
+	__m128i const p2r_hi = _mm_set1_epi32( (int) (p.pan_2_levels [1] >> 15) );
+	__m128i const p2r_lo = _mm_set1_epi32( (int) (p.pan_2_levels [1] & 0x7FFF) );
+	__m128i const reverb_level = _mm_set1_epi32( (int) p.reverb_level );
+	__m128i const echo_level = _mm_set1_epi32( (int) p.echo_level );
+	__m128i const low16 = _mm_set1_epi32( 0xFFFF );
+
+	blip_sample_t* const reverb_buf = p.reverb_buf;
+	blip_sample_t* const echo_buf = p.echo_buf;
+	int reverb_pos = p.reverb_pos;
+	int echo_pos = p.echo_pos;
+
+	for ( int const end = k + n; k < end; k += 4 )
 	{
-		int sum1_s = BLIP_READER_READ( sq1 );
-		int sum2_s = BLIP_READER_READ( sq2 );
+		__m128i const sq1 = FX_LOAD( &b.sq1 [k] );
+		__m128i const sq2 = FX_LOAD( &b.sq2 [k] );
+
+		// left entries are at even offsets, right at odd
+		__m128i rev_l = FX_LOAD( &reverb_buf [(reverb_pos + p.reverb_delay_l) & reverb_mask] );
+		__m128i rev_r = FX_LOAD( &reverb_buf [((reverb_pos + p.reverb_delay_r) & reverb_mask) - 1] );
+		rev_l = _mm_srai_epi32( _mm_slli_epi32( rev_l, 16 ), 16 );
+		rev_r = _mm_srai_epi32( rev_r, 16 );
+
+		__m128i new_reverb_l = _mm_add_epi32(
+				_mm_add_epi32( fx_pan_sse2( sq1, p1l_hi, p1l_lo ), fx_pan_sse2( sq2, p2l_hi, p2l_lo ) ),
+				_mm_add_epi32( FX_LOAD( &b.l1 [k] ), rev_l ) );
+		__m128i new_reverb_r = _mm_add_epi32(
+				_mm_add_epi32( fx_pan_sse2( sq1, p1r_hi, p1r_lo ), fx_pan_sse2( sq2, p2r_hi, p2r_lo ) ),
+				_mm_add_epi32( FX_LOAD( &b.r1 [k] ), rev_r ) );
+
+		// truncated to 16 bits and interleaved
+		_mm_storeu_si128( (__m128i*) &reverb_buf [reverb_pos], _mm_or_si128(
+				_mm_and_si128( fx_level_sse2( new_reverb_l, reverb_level ), low16 ),
+				_mm_slli_epi32( fx_level_sse2( new_reverb_r, reverb_level ), 16 ) ) );
+		reverb_pos += 8;
+
+		__m128i echo_l = _mm_loadl_epi64( (__m128i const*) &echo_buf [(echo_pos + p.echo_delay_l) & echo_mask] );
+		__m128i echo_r = _mm_loadl_epi64( (__m128i const*) &echo_buf [(echo_pos + p.echo_delay_r) & echo_mask] );
+		echo_l = _mm_srai_epi32( _mm_unpacklo_epi16( echo_l, echo_l ), 16 );
+		echo_r = _mm_srai_epi32( _mm_unpacklo_epi16( echo_r, echo_r ), 16 );
+
+		__m128i const center = FX_LOAD( &b.center [k] );
+		__m128i left = _mm_add_epi32( _mm_add_epi32( new_reverb_l, center ),
+				_mm_add_epi32( FX_LOAD( &b.l2 [k] ), fx_level_sse2( echo_l, echo_level ) ) );
+		__m128i right = _mm_add_epi32( _mm_add_epi32( new_reverb_r, center ),
+				_mm_add_epi32( FX_LOAD( &b.r2 [k] ), fx_level_sse2( echo_r, echo_level ) ) );
+
+		_mm_storel_epi64( (__m128i*) &echo_buf [echo_pos], _mm_packs_epi32( center, center ) );
+		echo_pos += 4;
+
+		// saturation matches the scalar clamp for sums below 2^24
+		_mm_storeu_si128( (__m128i*) &b.out [k * 2], _mm_packs_epi32(
+				_mm_unpacklo_epi32( left, right ), _mm_unpackhi_epi32( left, right ) ) );
+	}
 
-		BLIP_READER_NEXT( sq1, bass );
-		BLIP_READER_NEXT( sq2, bass );
+	p.reverb_pos = reverb_pos & reverb_mask;
+	p.echo_pos = echo_pos & echo_mask;
+}
 
-		int new_reverb_l = FMUL( sum1_s, chans.pan_1_levels [0] ) +
-				FMUL( sum2_s, chans.pan_2_levels [0] ) + BLIP_READER_READ( l1 ) +
-				reverb_buf [(reverb_pos + chans.reverb_delay_l) & reverb_mask];
+#undef FX_LOAD
 
-		int new_reverb_r = FMUL( sum1_s, chans.pan_1_levels [1] ) +
-				FMUL( sum2_s, chans.pan_2_levels [1] ) + BLIP_READER_READ( r1 ) +
-				reverb_buf [(reverb_pos + chans.reverb_delay_r) & reverb_mask];
+#define fx_run_simd fx_run_sse2
 
-		BLIP_READER_NEXT( l1, bass );
-		BLIP_READER_NEXT( r1, bass );
+#endif
 
-		fixed_t reverb_level = chans.reverb_level;
-		reverb_buf [reverb_pos] = (blip_sample_t) FMUL( new_reverb_l, reverb_level );
-		reverb_buf [reverb_pos + 1] = (blip_sample_t) FMUL( new_reverb_r, reverb_level );
-		reverb_pos = (reverb_pos + 2) & reverb_mask;
+// Mixes count frames of b. Vector code is only used when all inputs are known
+// to fit in 16 bits, which keeps its intermediate values in range.
+static void fx_run( fx_params_t& p, fx_block_t& b, int count, bool simd )
+{
+	int k = 0;
+	#ifdef fx_run_simd
+		if ( simd )
+		{
+			while ( k < count )
+			{
+				int n = fx_span( p, count - k ) & ~3;
+				if ( n )
+				{
+					fx_run_simd( p, b, k, n );
+					k += n;
+				}
+				else
+				{
+					fx_frame( p, b, k++ );
+				}
+			}
+		}
+	#else
+		(void) simd;
+	#endif
 
-		int sum3_s = BLIP_READER_READ( center );
-		BLIP_READER_NEXT( center, bass );
+	for ( ; k < count; k++ )
+		fx_frame( p, b, k );
+}
 
-		int left = new_reverb_l + sum3_s + BLIP_READER_READ( l2 ) + FMUL( chans.echo_level,
-				echo_buf [(echo_pos + chans.echo_delay_l) & echo_mask] );
-		int right = new_reverb_r + sum3_s + BLIP_READER_READ( r2 ) + FMUL( chans.echo_level,
-				echo_buf [(echo_pos + chans.echo_delay_r) & echo_mask] );
+// Reads count samples into out, noting in range whether any fall outside
+// 16 bits. Readers of silent buffers are left alone, since they would only
+// produce zeros.
+#define FX_READ( name, out, live ) \
+	if ( live )\
+	{\
+		for ( int n = 0; n < count; n++ )\
+		{\
+			int s = BLIP_READER_READ( name );\
+			BLIP_READER_NEXT( name, bass );\
+			range |= (unsigned) (s + 0x8000);\
+			out [n] = s;\
+		}\
+	}\
+	else\
+	{\
+		blarg_memset( out, 0, count * sizeof *out );\
+	}
 
-		BLIP_READER_NEXT( l2, bass );
-		BLIP_READER_NEXT( r2, bass );
+void Effects_Buffer::mix_effects( blip_sample_t* out_, int32_t frames, bool stereo )
+{
+	fx_block_t b;
 
-		echo_buf [echo_pos] = sum3_s;
-		echo_pos = (echo_pos + 1) & echo_mask;
+	for ( int i = 0; i < max_voices; i++ )
+	{
+		if ( fx [i].silent && fx [i].fx_silent )
+		{
+			skip_voice( out_, frames, i );
+			continue;
+		}
 
-		if ( (int16_t) left != left )
-			left = 0x7FFF - (left >> 24);
+		Blip_Buffer* const bb = &bufs [i*max_buf_count];
+		bool live [max_buf_count];
+		for ( int j = 0; j < max_buf_count; j++ )
+			live [j] = (stereo || j < 3) && bb [j].non_silent();
+
+		// side readers are never advanced when mono, so they alias center
+		int const side = stereo ? 1 : 0;
+		int const bass = BLIP_READER_BASS( bb [2] );
+		BLIP_READER_BEGIN( center, bb [2] );
+		BLIP_READER_BEGIN( l1, bb [2 + side * 1] );
+		BLIP_READER_BEGIN( r1, bb [2 + side * 2] );
+		BLIP_READER_BEGIN( l2, bb [2 + side * 3] );
+		BLIP_READER_BEGIN( r2, bb [2 + side * 4] );
+		BLIP_READER_BEGIN( sq1, bb [0] );
+		BLIP_READER_BEGIN( sq2, bb [1] );
+
+		fx_params_t p;
+		p.reverb_buf      = fx [i].reverb_buf;
+		p.echo_buf        = fx [i].echo_buf;
+		p.reverb_pos      = fx [i].reverb_pos;
+		p.echo_pos        = fx [i].echo_pos;
+		p.pan_1_levels [0] = chans.pan_1_levels [0];
+		p.pan_1_levels [1] = chans.pan_1_levels [1];
+		p.pan_2_levels [0] = chans.pan_2_levels [0];
+		p.pan_2_levels [1] = chans.pan_2_levels [1];
+		p.reverb_level    = chans.reverb_level;
+		p.echo_level      = chans.echo_level;
+		p.reverb_delay_l  = chans.reverb_delay_l;
+		p.reverb_delay_r  = chans.reverb_delay_r;
+		p.echo_delay_l    = chans.echo_delay_l;
+		p.echo_delay_r    = chans.echo_delay_r;
+
+		blip_sample_t* BLIP_RESTRICT out = out_ + i*2;
+		for ( int32_t remain = frames; remain; )
+		{
+			int const count = min( remain, (int32_t) fx_block_size );
+			unsigned range = 0;
+			FX_READ( sq1,    b.sq1,    live [0] )
+			FX_READ( sq2,    b.sq2,    live [1] )
+			FX_READ( center, b.center, live [2] )
+			FX_READ( l1,     b.l1,     live [3] )
+			FX_READ( r1,     b.r1,     live [4] )
+			FX_READ( l2,     b.l2,     live [5] )
+			FX_READ( r2,     b.r2,     live [6] )
+
+			fx_run( p, b, count, fx_simd && range < 0x10000 );
+
+			if ( max_voices == 1 )
+			{
+				memcpy( out, b.out, count * 2 * sizeof *out );
+				out += count * 2;
+			}
+			else
+			{
+				for ( int n = 0; n < count; n++ )
+				{
+					out [0] = b.out [n * 2 + 0];
+					out [1] = b.out [n * 2 + 1];
+					out += max_voices*2;
+				}
+			}
+			remain -= count;
+		}
 
-		if ( (int16_t) right != right )
-			right = 0x7FFF - (right >> 24);
+		fx [i].reverb_pos = p.reverb_pos;
+		fx [i].echo_pos = p.echo_pos;
 
-		out [i*2+0] = left;
-		out [i*2+1] = right;
+		BLIP_READER_END( l1, bb [2 + side * 1] );
+		BLIP_READER_END( r1, bb [2 + side * 2] );
+		BLIP_READER_END( l2, bb [2 + side * 3] );
+		BLIP_READER_END( r2, bb [2 + side * 4] );
+		BLIP_READER_END( sq1, bb [0] );
+		BLIP_READER_END( sq2, bb [1] );
+		BLIP_READER_END( center, bb [2] );
 
-		out += max_voices*2;
+		if ( fx [i].silent )
+			fx_settled( i, frames );
 	}
-	this->reverb_pos[i] = reverb_pos;
-	this->echo_pos[i] = echo_pos;
-
-	BLIP_READER_END( l1, bufs [i*max_buf_count+3] );
-	BLIP_READER_END( r1, bufs [i*max_buf_count+4] );
-	BLIP_READER_END( l2, bufs [i*max_buf_count+5] );
-	BLIP_READER_END( r2, bufs [i*max_buf_count+6] );
-	BLIP_READER_END( sq1, bufs [i*max_buf_count+0] );
-	BLIP_READER_END( sq2, bufs [i*max_buf_count+1] );
-	BLIP_READER_END( center, bufs [i*max_buf_count+2] );
-    }
 }
-
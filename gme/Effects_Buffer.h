@@ -75,14 +75,22 @@ private:
 	long effect_remain;
 	int buf_count;
 	bool effects_enabled;
+	bool fx_simd; // levels are in the range vector mixing handles
 
-	DECLARE_OBJECTVECTOR(BlipSampleVector, blip_sample_t)
-	DECLARE_OBJECTVECTOR(BlipSampleVectorVector, BlipSampleVector)
-	BlipSampleVectorVector reverb_buf;
-	BlipSampleVectorVector echo_buf;
-	DECLARE_SIMPLEVECTOR(IntVector, int)
-	IntVector reverb_pos;
-	IntVector echo_pos;
+	// Samples of every Blip_Buffer and echo/reverb line, allocated together by
+	// set_sample_rate() and laid out one voice after another
+	blargg_vector<char> arena;
+	struct voice_fx_t {
+		blip_sample_t* reverb_buf;
+		blip_sample_t* echo_buf;
+		int reverb_pos;
+		int echo_pos;
+		bool silent;      // none of voice's buffers have anything to mix
+		bool fx_silent;   // echo and reverb lines are known to be all zero
+		long quiet_count; // frames mixed since voice last had input
+	};
+	DECLARE_SIMPLEVECTOR(VoiceFxVector, voice_fx_t)
+	VoiceFxVector fx;
 
 	struct {
 		fixed_t pan_1_levels [2];
@@ -95,10 +103,12 @@ private:
 		fixed_t reverb_level;
 	} chans;
 
+	void update_silence();
+	void skip_voice( blip_sample_t*, int32_t, int voice );
+	void fx_settled( int voice, int32_t count );
 	void mix_mono( blip_sample_t*, int32_t );
 	void mix_stereo( blip_sample_t*, int32_t );
-	void mix_enhanced( blip_sample_t*, int32_t );
-	void mix_mono_enhanced( blip_sample_t*, int32_t );
+	void mix_effects( blip_sample_t*, int32_t, bool stereo );
 };
 
 #endif
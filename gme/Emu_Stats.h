@@ -0,0 +1,48 @@
+// Performance counters kept by each Music_Emu (see gme_get_stats())
+
+// Game_Music_Emu https://bitbucket.org/mpyne/game-music-emu/
+#ifndef EMU_STATS_H
+#define EMU_STATS_H
+
+#include "gme.h"
+#include <string.h>
+#include <chrono>
+
+struct Emu_Stats {
+	gme_stats_t counts;
+	bool timed; // also measure time spent, not just counts
+
+	Emu_Stats() : timed( false ) { clear(); }
+
+	// Clears counts, but leaves timed as is
+	void clear() { memset( &counts, 0, sizeof counts ); }
+
+	// Monotonic time in nanoseconds
+	static int64_t now();
+};
+
+// Adds time between construction and destruction to counter, if stats are timed.
+// Costs only a test of stats.timed otherwise.
+class Emu_Stats_Timer {
+public:
+	Emu_Stats_Timer( Emu_Stats const& stats, int64_t& counter ) :
+		counter_( stats.timed ? &counter : 0 ),
+		start( counter_ ? Emu_Stats::now() : 0 ) { }
+
+	~Emu_Stats_Timer() { if ( counter_ ) *counter_ += Emu_Stats::now() - start; }
+private:
+	int64_t* counter_;
+	int64_t start;
+
+	// noncopyable
+	Emu_Stats_Timer( const Emu_Stats_Timer& );
+	Emu_Stats_Timer& operator = ( const Emu_Stats_Timer& );
+};
+
+inline int64_t Emu_Stats::now()
+{
+	using namespace std::chrono;
+	return duration_cast<nanoseconds>( steady_clock::now().time_since_epoch() ).count();
+}
+
+#endif
@@ -1,6 +1,7 @@
 // Game_Music_Emu https://bitbucket.org/mpyne/game-music-emu/
 
 #include "Fir_Resampler.h"
+#include "blargg_simd.h"
 
 #include <string.h>
 #include <stdlib.h>
@@ -54,6 +55,8 @@ static void gen_sinc( double rolloff, int width, double offset, double spacing,
 
 Fir_Resampler_::Fir_Resampler_( int width, sample_t* impulses_ ) :
 	width_( width ),
+	pending_width( width ),
+	max_width( width ),
 	write_offset( width * stereo - stereo ),
 	impulses( impulses_ )
 {
@@ -67,6 +70,12 @@ Fir_Resampler_::Fir_Resampler_( int width, sample_t* impulses_ ) :
 
 Fir_Resampler_::~Fir_Resampler_() { }
 
+void Fir_Resampler_::set_width( int width )
+{
+	require( width >= 4 && width % 2 == 0 );
+	pending_width = (width < max_width) ? width : max_width;
+}
+
 void Fir_Resampler_::clear()
 {
 	imp_phase = 0;
@@ -86,6 +95,8 @@ blargg_err_t Fir_Resampler_::buffer_size( int new_size )
 
 double Fir_Resampler_::time_ratio( double new_factor, double rolloff, double gain )
 {
+	// impulses are laid out for width_, so it can only change along with them
+	width_ = pending_width;
 	ratio_ = new_factor;
 
 	double fstep = 0.0;
@@ -199,3 +210,211 @@ int Fir_Resampler_::skip_input( long count )
 
 	return count;
 }
+
+// SIMD filtering
+
+// The filters compute the same 32-bit sums as the scalar loop in read(), just
+// in a different order. Integer addition wraps the same way in any order, so
+// the output is identical.
+
+typedef Fir_Resampler_::sample_t sample_t;
+
+#if BLARGG_SIMD_SSE2
+
+// Deinterleaves the stereo pairs of one 128-bit vector of input into
+// L0 L1 R0 R1 L2 L3 R2 R3, so that pmaddwd against i0 i1 i0 i1 i2 i3 i2 i3
+// gives partial sums of L, R, L, R
+#define FIR_SHUFFLE _MM_SHUFFLE( 3, 1, 2, 0 )
+
+static inline __m128i fir_sse2_pairs( __m128i v )
+{
+	return _mm_shufflehi_epi16( _mm_shufflelo_epi16( v, FIR_SHUFFLE ), FIR_SHUFFLE );
+}
+
+struct fir_sse2
+{
+	static inline void filter( sample_t const* in, sample_t const* imp, int width, int32_t* lr )
+	{
+		__m128i sum = _mm_setzero_si128();
+		for ( int n = width >> 2; n; --n )
+		{
+			__m128i v = fir_sse2_pairs( _mm_loadu_si128( (__m128i const*) in ) );
+			__m128i c = _mm_loadl_epi64( (__m128i const*) imp );
+			sum = _mm_add_epi32( sum, _mm_madd_epi16( v, _mm_unpacklo_epi32( c, c ) ) );
+			in  += 8;
+			imp += 4;
+		}
+
+		if ( width & 2 )
+		{
+			__m128i v = fir_sse2_pairs( _mm_loadl_epi64( (__m128i const*) in ) );
+			int c2;
+			memcpy( &c2, imp, sizeof c2 );
+			__m128i c = _mm_cvtsi32_si128( c2 );
+			sum = _mm_add_epi32( sum, _mm_madd_epi16( v, _mm_unpacklo_epi32( c, c ) ) );
+		}
+
+		sum = _mm_add_epi32( sum, _mm_shuffle_epi32( sum, _MM_SHUFFLE( 1, 0, 3, 2 ) ) );
+		lr [0] = _mm_cvtsi128_si32( sum );
+		lr [1] = _mm_cvtsi128_si32( _mm_shuffle_epi32( sum, _MM_SHUFFLE( 1, 1, 1, 1 ) ) );
+	}
+};
+
+#if BLARGG_SIMD_AVX2
+
+struct fir_avx2
+{
+	BLARGG_TARGET_AVX2 static inline void filter( sample_t const* in, sample_t const* imp,
+			int width, int32_t* lr )
+	{
+		// i0 i1 i2 i3 i4 i5 i6 i7 -> i0 i1 i0 i1 i2 i3 i2 i3 | i4 i5 i4 i5 i6 i7 i6 i7
+		__m256i const dup = _mm256_setr_epi32( 0, 0, 1, 1, 2, 2, 3, 3 );
+		__m256i sum = _mm256_setzero_si256();
+		for ( int n = width >> 3; n; --n )
+		{
+			__m256i v = _mm256_loadu_si256( (__m256i const*) in );
+			v = _mm256_shufflehi_epi16( _mm256_shufflelo_epi16( v, FIR_SHUFFLE ), FIR_SHUFFLE );
+			__m256i c = _mm256_castsi128_si256( _mm_loadu_si128( (__m128i const*) imp ) );
+			c = _mm256_permutevar8x32_epi32( c, dup );
+			sum = _mm256_add_epi32( sum, _mm256_madd_epi16( v, c ) );
+			in  += 16;
+			imp += 8;
+		}
+
+		__m128i sum4 = _mm_add_epi32( _mm256_castsi256_si128( sum ),
+				_mm256_extracti128_si256( sum, 1 ) );
+
+		if ( width & 4 )
+		{
+			__m128i v = fir_sse2_pairs( _mm_loadu_si128( (__m128i const*) in ) );
+			__m128i c = _mm_loadl_epi64( (__m128i const*) imp );
+			sum4 = _mm_add_epi32( sum4, _mm_madd_epi16( v, _mm_unpacklo_epi32( c, c ) ) );
+			in  += 8;
+			imp += 4;
+		}
+
+		if ( width & 2 )
+		{
+			__m128i v = fir_sse2_pairs( _mm_loadl_epi64( (__m128i const*) in ) );
+			int c2;
+			memcpy( &c2, imp, sizeof c2 );
+			__m128i c = _mm_cvtsi32_si128( c2 );
+			sum4 = _mm_add_epi32( sum4, _mm_madd_epi16( v, _mm_unpacklo_epi32( c, c ) ) );
+		}
+
+		sum4 = _mm_add_epi32( sum4, _mm_shuffle_epi32( sum4, _MM_SHUFFLE( 1, 0, 3, 2 ) ) );
+		lr [0] = _mm_cvtsi128_si32( sum4 );
+		lr [1] = _mm_cvtsi128_si32( _mm_shuffle_epi32( sum4, _MM_SHUFFLE( 1, 1, 1, 1 ) ) );
+	}
+};
+
+#endif
+#endif
+
+#if BLARGG_SIMD_SSE2
+
+struct fir_state_t
+{
+	sample_t const* in;
+	sample_t const* end_pos;
+	sample_t const* impulses;
+	int width;
+	int res;
+	int imp_phase;
+	uint32_t skip_bits;
+	int step;
+};
+
+// Main loop of read() with the FIR computed by Filter. Returns end of output.
+template<class Filter>
+static inline sample_t* fir_read( fir_state_t& s, sample_t* out, int count )
+{
+	sample_t const* in = s.in;
+	uint32_t skip = s.skip_bits >> s.imp_phase;
+	sample_t const* imp = s.impulses + s.imp_phase * s.width;
+	int remain = s.res - s.imp_phase;
+	int const step = s.step;
+	int const width = s.width;
+
+	do
+	{
+		if ( --count < 0 )
+			break;
+
+		int32_t lr [2];
+		Filter::filter( in, imp, width, lr );
+		imp += width;
+
+		remain--;
+
+		in += (skip * 2) & 2; // stereo
+		skip >>= 1;
+
+		if ( !remain )
+		{
+			imp = s.impulses;
+			skip = s.skip_bits;
+			remain = s.res;
+		}
+
+		out [0] = (sample_t) (lr [0] >> 15);
+		out [1] = (sample_t) (lr [1] >> 15);
+
+		in += step;
+		out += 2;
+	}
+	while ( in <= s.end_pos );
+
+	s.in = in;
+	s.imp_phase = s.res - remain;
+	return out;
+}
+
+#if BLARGG_SIMD_AVX2
+BLARGG_TARGET_AVX2 BLARGG_FLATTEN static sample_t* fir_read_avx2( fir_state_t& s, sample_t* out, int count )
+{
+	return fir_read<fir_avx2>( s, out, count );
+}
+#endif
+
+int Fir_Resampler_::read_simd_( sample_t* out_begin, int32_t count )
+{
+	double const ratio1 = ratio_ - 1.0;
+	if ( (ratio1 >= 0 ? ratio1 : -ratio1) < 0.00001 )
+		return -1; // see read()
+
+	sample_t* out = out_begin;
+	fir_state_t s;
+	s.in        = buf.begin();
+	s.impulses  = impulses;
+	s.width     = width_;
+	s.res       = res;
+	s.imp_phase = imp_phase;
+	s.skip_bits = skip_bits;
+	s.step      = step;
+
+	if ( write_pos - s.in >= width_ * stereo )
+	{
+		s.end_pos = write_pos - width_ * stereo;
+	#if BLARGG_SIMD_AVX2
+		if ( blargg_simd_level() >= blargg_simd_avx2 )
+			out = fir_read_avx2( s, out, count >> 1 );
+		else
+	#endif
+			out = fir_read<fir_sse2>( s, out, count >> 1 );
+	}
+
+	imp_phase = s.imp_phase;
+
+	int left = (int)(write_pos - s.in);
+	write_pos = &buf [left];
+	blarg_memmove( buf.begin(), s.in, left * sizeof *s.in );
+
+	return (int)(out - out_begin);
+}
+
+#else
+
+int Fir_Resampler_::read_simd_( sample_t*, int32_t ) { return -1; }
+
+#endif
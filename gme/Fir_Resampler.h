@@ -19,6 +19,11 @@ public:
 	// Current input/output ratio
 	double ratio() const { return ratio_; }
 
+	// Use a FIR of only 'width' points, where width is even, 4 or more, and
+	// no more than Fir_Resampler's width. Fewer points are faster but roll off less
+	// cleanly. Takes effect at next time_ratio().
+	void set_width( int width );
+
 // Input
 
 	typedef short sample_t;
@@ -62,7 +67,9 @@ protected:
 	sample_t* write_pos;
 	int res;
 	int imp_phase;
-	int const width_;
+	int width_;
+	int pending_width; // set_width() value, applied by time_ratio()
+	int const max_width;
 	int const write_offset;
 	uint32_t skip_bits;
 	int step;
@@ -72,6 +79,10 @@ protected:
 
 	Fir_Resampler_( int width, sample_t* );
 	int avail_( int32_t input_count ) const;
+
+	// Same as Fir_Resampler::read() but uses SSE2/AVX2. Returns -1 if
+	// these aren't available or there's no resampling to do.
+	int read_simd_( sample_t* out, int32_t count );
 };
 
 // Width is number of points in FIR. Must be even and 4 or more. More points give
@@ -101,11 +112,19 @@ inline void Fir_Resampler_::write( long count )
 template<int width>
 int Fir_Resampler<width>::read( sample_t* out_begin, int32_t count )
 {
+	int simd_count = read_simd_( out_begin, count );
+	if ( simd_count >= 0 )
+		return simd_count;
+
+	// width_ is less than width after set_width()
+	int const points = this->width_;
+	sample_t const* const first_imp = Fir_Resampler_::impulses;
+
 	sample_t* out = out_begin;
 	const sample_t* in = buf.begin();
 	sample_t* end_pos = write_pos;
 	uint32_t skip = skip_bits >> imp_phase;
-	sample_t const* imp = impulses [imp_phase];
+	sample_t const* imp = first_imp + imp_phase * points;
 	int remain = res - imp_phase;
 	int const step = this->step;
 
@@ -117,10 +136,20 @@ int Fir_Resampler<width>::read( sample_t* out_begin, int32_t count )
 	const bool should_resample =
 		( ratio1 >= 0 ? ratio1 : -ratio1 ) >= 0.00001;
 
-	if ( end_pos - in >= width * stereo )
+	if ( end_pos - in >= points * stereo )
 	{
-		end_pos -= width * stereo;
-		do
+		end_pos -= points * stereo;
+		if ( !should_resample && step == stereo )
+		{
+			// copy the same samples as the loop below, all at once
+			int pairs = (int) ((end_pos - in) / stereo) + 1;
+			if ( pairs > count )
+				pairs = count;
+			memcpy( out, in, pairs * stereo * sizeof *out );
+			in  += pairs * stereo;
+			out += pairs * stereo;
+		}
+		else do
 		{
 			count--;
 			if ( count < 0 )
@@ -139,7 +168,7 @@ int Fir_Resampler<width>::read( sample_t* out_begin, int32_t count )
 
 				const sample_t* i = in;
 
-				for ( int n = width / 2; n; --n )
+				for ( int n = points / 2; n; --n )
 				{
 					int pt0 = imp [0];
 					l += pt0 * i [0];
@@ -161,7 +190,7 @@ int Fir_Resampler<width>::read( sample_t* out_begin, int32_t count )
 
 				if ( !remain )
 				{
-					imp = impulses [0];
+					imp = first_imp;
 					skip = skip_bits;
 					remain = res;
 				}
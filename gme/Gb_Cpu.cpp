@@ -21,6 +21,23 @@ Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA */
 
 #include "blargg_source.h"
 
+// GB_CPU_THREADED: Jump straight to each opcode's handler through a table of
+// label addresses (a GCC extension) rather than through the switch, which the
+// compiler splits into several range and bit tests.
+#ifndef GB_CPU_THREADED
+	#if defined (__GNUC__) && !defined (GB_CPU_LOG_H)
+		#define GB_CPU_THREADED 1
+	#else
+		#define GB_CPU_THREADED 0
+	#endif
+#endif
+
+#if GB_CPU_THREADED
+	#define OP_LABEL( n ) op_##n:
+#else
+	#define OP_LABEL( n )
+#endif
+
 // Common instructions:
 //
 // 365880   FA      LD  A,IND16
@@ -79,9 +96,12 @@ void Gb_Cpu::map_code( gb_addr_t start, unsigned size, void* data )
 		set_code_page( first_page + i, (uint8_t*) data + i * page_size );
 }
 
-#define READ( addr )            CPU_READ( this, (addr), s.remain )
-#define WRITE( addr, data )     {CPU_WRITE( this, (addr), (data), s.remain );}
-#define READ_FAST( addr, out )  CPU_READ_FAST( this, (addr), s.remain, out )
+// Instruction count is kept in a register and only stored where the emulator
+// can observe it through remain()
+#define FLUSH_REMAIN()          (void) (s.remain = s_remain)
+#define READ( addr )            (FLUSH_REMAIN(), CPU_READ( this, (addr), s_remain ))
+#define WRITE( addr, data )     {FLUSH_REMAIN(); CPU_WRITE( this, (addr), (data), s_remain );}
+#define READ_FAST( addr, out )  CPU_READ_FAST( this, (addr), s_remain, out )
 #define READ_PROG( addr )       (s.code_map [(addr) >> page_shift] [PAGE_OFFSET( addr )])
 
 unsigned const z_flag = 0x80;
@@ -120,6 +140,7 @@ bool Gb_Cpu::run( int32_t cycle_count )
 	unsigned pc = r.pc;
 	unsigned sp = r.sp;
 	unsigned flags = r.flags;
+	int32_t s_remain = s.remain;
 
 loop:
 
@@ -143,7 +164,7 @@ loop:
 
 #define GET_ADDR()  GET_LE16( instr )
 
-	if ( !--s.remain )
+	if ( !--s_remain )
 		goto stop;
 
 	unsigned data;
@@ -153,6 +174,28 @@ loop:
 		gb_cpu_log( "new", pc - 1, op, data, instr [1] );
 	#endif
 
+	#if GB_CPU_THREADED
+		static void* const op_table [0x100] = {
+			&&op_00, &&op_01, &&op_02, &&op_03, &&op_04, &&op_05, &&op_06, &&op_07, &&op_08, &&op_09, &&op_0A, &&op_0B, &&op_0C, &&op_0D, &&op_0E, &&op_0F,
+			&&op_10, &&op_11, &&op_12, &&op_13, &&op_14, &&op_15, &&op_16, &&op_17, &&op_18, &&op_19, &&op_1A, &&op_1B, &&op_1C, &&op_1D, &&op_1E, &&op_1F,
+			&&op_20, &&op_21, &&op_22, &&op_23, &&op_24, &&op_25, &&op_26, &&op_27, &&op_28, &&op_29, &&op_2A, &&op_2B, &&op_2C, &&op_2D, &&op_2E, &&op_2F,
+			&&op_30, &&op_31, &&op_32, &&op_33, &&op_34, &&op_35, &&op_36, &&op_37, &&op_38, &&op_39, &&op_3A, &&op_3B, &&op_3C, &&op_3D, &&op_3E, &&op_3F,
+			&&op_40, &&op_41, &&op_42, &&op_43, &&op_44, &&op_45, &&op_46, &&op_47, &&op_48, &&op_49, &&op_4A, &&op_4B, &&op_4C, &&op_4D, &&op_4E, &&op_4F,
+			&&op_50, &&op_51, &&op_52, &&op_53, &&op_54, &&op_55, &&op_56, &&op_57, &&op_58, &&op_59, &&op_5A, &&op_5B, &&op_5C, &&op_5D, &&op_5E, &&op_5F,
+			&&op_60, &&op_61, &&op_62, &&op_63, &&op_64, &&op_65, &&op_66, &&op_67, &&op_68, &&op_69, &&op_6A, &&op_6B, &&op_6C, &&op_6D, &&op_6E, &&op_6F,
+			&&op_70, &&op_71, &&op_72, &&op_73, &&op_74, &&op_75, &&op_76, &&op_77, &&op_78, &&op_79, &&op_7A, &&op_7B, &&op_7C, &&op_7D, &&op_7E, &&op_7F,
+			&&op_80, &&op_81, &&op_82, &&op_83, &&op_84, &&op_85, &&op_86, &&op_87, &&op_88, &&op_89, &&op_8A, &&op_8B, &&op_8C, &&op_8D, &&op_8E, &&op_8F,
+			&&op_90, &&op_91, &&op_92, &&op_93, &&op_94, &&op_95, &&op_96, &&op_97, &&op_98, &&op_99, &&op_9A, &&op_9B, &&op_9C, &&op_9D, &&op_9E, &&op_9F,
+			&&op_A0, &&op_A1, &&op_A2, &&op_A3, &&op_A4, &&op_A5, &&op_A6, &&op_A7, &&op_A8, &&op_A9, &&op_AA, &&op_AB, &&op_AC, &&op_AD, &&op_AE, &&op_AF,
+			&&op_B0, &&op_B1, &&op_B2, &&op_B3, &&op_B4, &&op_B5, &&op_B6, &&op_B7, &&op_B8, &&op_B9, &&op_BA, &&op_BB, &&op_BC, &&op_BD, &&op_BE, &&op_BF,
+			&&op_C0, &&op_C1, &&op_C2, &&op_C3, &&op_C4, &&op_C5, &&op_C6, &&op_C7, &&op_C8, &&op_C9, &&op_CA, &&op_CB, &&op_CC, &&op_CD, &&op_CE, &&op_CF,
+			&&op_D0, &&op_D1, &&op_D2, &&op_D3, &&op_D4, &&op_D5, &&op_D6, &&op_D7, &&op_D8, &&op_D9, &&op_DA, &&op_DB, &&op_DC, &&op_DD, &&op_DE, &&op_DF,
+			&&op_E0, &&op_E1, &&op_E2, &&op_E3, &&op_E4, &&op_E5, &&op_E6, &&op_E7, &&op_E8, &&op_E9, &&op_EA, &&op_EB, &&op_EC, &&op_ED, &&op_EE, &&op_EF,
+			&&op_F0, &&op_F1, &&op_F2, &&op_F3, &&op_F4, &&op_F5, &&op_F6, &&op_F7, &&op_F8, &&op_F9, &&op_FA, &&op_FB, &&op_FC, &&op_FD, &&op_FE, &&op_FF,
+		};
+		goto *op_table [op];
+	#endif
+
 	switch ( op )
 	{
 
@@ -168,47 +211,47 @@ loop:
 
 // Most Common
 
-	case 0x20: // JR NZ
+	case 0x20: OP_LABEL( 20 ) // JR NZ
 		BRANCH( !(flags & z_flag) )
 
-	case 0x21: // LD HL,IMM (common)
+	case 0x21: OP_LABEL( 21 ) // LD HL,IMM (common)
 		rp.hl = GET_ADDR();
 		pc += 2;
 		goto loop;
 
-	case 0x28: // JR Z
+	case 0x28: OP_LABEL( 28 ) // JR Z
 		BRANCH( flags & z_flag )
 
 	{
 		unsigned temp;
-	case 0xF0: // LD A,(0xFF00+imm)
+	case 0xF0: OP_LABEL( F0 ) // LD A,(0xFF00+imm)
 		temp = data | 0xFF00;
 		pc++;
 		goto ld_a_ind_comm;
 
-	case 0xF2: // LD A,(0xFF00+C)
+	case 0xF2: OP_LABEL( F2 ) // LD A,(0xFF00+C)
 		temp = rg.c | 0xFF00;
 		goto ld_a_ind_comm;
 
-	case 0x0A: // LD A,(BC)
+	case 0x0A: OP_LABEL( 0A ) // LD A,(BC)
 		temp = rp.bc;
 		goto ld_a_ind_comm;
 
-	case 0x3A: // LD A,(HL-)
+	case 0x3A: OP_LABEL( 3A ) // LD A,(HL-)
 		temp = rp.hl;
 		rp.hl = temp - 1;
 		goto ld_a_ind_comm;
 
-	case 0x1A: // LD A,(DE)
+	case 0x1A: OP_LABEL( 1A ) // LD A,(DE)
 		temp = rp.de;
 		goto ld_a_ind_comm;
 
-	case 0x2A: // LD A,(HL+) (common)
+	case 0x2A: OP_LABEL( 2A ) // LD A,(HL+) (common)
 		temp = rp.hl;
 		rp.hl = temp + 1;
 		goto ld_a_ind_comm;
 
-	case 0xFA: // LD A,IND16 (common)
+	case 0xFA: OP_LABEL( FA ) // LD A,IND16 (common)
 		temp = GET_ADDR();
 		pc += 2;
 	ld_a_ind_comm:
@@ -216,20 +259,20 @@ loop:
 		goto loop;
 	}
 
-	case 0xBE: // CMP (HL)
+	case 0xBE: OP_LABEL( BE ) // CMP (HL)
 		data = READ( rp.hl );
 		goto cmp_comm;
 
-	case 0xB8: // CMP B
-	case 0xB9: // CMP C
-	case 0xBA: // CMP D
-	case 0xBB: // CMP E
-	case 0xBC: // CMP H
-	case 0xBD: // CMP L
+	case 0xB8: OP_LABEL( B8 ) // CMP B
+	case 0xB9: OP_LABEL( B9 ) // CMP C
+	case 0xBA: OP_LABEL( BA ) // CMP D
+	case 0xBB: OP_LABEL( BB ) // CMP E
+	case 0xBC: OP_LABEL( BC ) // CMP H
+	case 0xBD: OP_LABEL( BD ) // CMP L
 		data = R8( op & 7 );
 		goto cmp_comm;
 
-	case 0xFE: // CMP IMM
+	case 0xFE: OP_LABEL( FE ) // CMP IMM
 		pc++;
 	cmp_comm:
 		op = rg.a;
@@ -243,25 +286,25 @@ loop:
 		flags |= z_flag;
 		goto loop;
 
-	case 0x46: // LD B,(HL)
-	case 0x4E: // LD C,(HL)
-	case 0x56: // LD D,(HL)
-	case 0x5E: // LD E,(HL)
-	case 0x66: // LD H,(HL)
-	case 0x6E: // LD L,(HL)
-	case 0x7E:{// LD A,(HL)
+	case 0x46: OP_LABEL( 46 ) // LD B,(HL)
+	case 0x4E: OP_LABEL( 4E ) // LD C,(HL)
+	case 0x56: OP_LABEL( 56 ) // LD D,(HL)
+	case 0x5E: OP_LABEL( 5E ) // LD E,(HL)
+	case 0x66: OP_LABEL( 66 ) // LD H,(HL)
+	case 0x6E: OP_LABEL( 6E ) // LD L,(HL)
+	case 0x7E: OP_LABEL( 7E ){// LD A,(HL)
 		unsigned addr = rp.hl;
 		READ_FAST( addr, R8( (op >> 3) & 7 ) );
 		goto loop;
 	}
 
-	case 0xC4: // CNZ (next-most-common)
+	case 0xC4: OP_LABEL( C4 ) // CNZ (next-most-common)
 		pc += 2;
 		if ( flags & z_flag )
 			goto loop;
 	call:
 		pc -= 2; // FALLTHRU
-	case 0xCD: // CALL (most-common)
+	case 0xCD: OP_LABEL( CD ) // CALL (most-common)
 		data = pc + 2;
 		pc = GET_ADDR();
 	push:
@@ -271,30 +314,30 @@ loop:
 		WRITE( sp, data & 0xFF );
 		goto loop;
 
-	case 0xC8: // RNZ (next-most-common)
+	case 0xC8: OP_LABEL( C8 ) // RNZ (next-most-common)
 		if ( !(flags & z_flag) )
 			goto loop;
 		// FALLTHRU
-	case 0xC9: // RET (most common)
+	case 0xC9: OP_LABEL( C9 ) // RET (most common)
 	ret:
 		pc = READ( sp );
 		pc += 0x100 * READ( sp + 1 );
 		sp = (sp + 2) & 0xFFFF;
 		goto loop;
 
-	case 0x00: // NOP
-	case 0x40: // LD B,B
-	case 0x49: // LD C,C
-	case 0x52: // LD D,D
-	case 0x5B: // LD E,E
-	case 0x64: // LD H,H
-	case 0x6D: // LD L,L
-	case 0x7F: // LD A,A
+	case 0x00: OP_LABEL( 00 ) // NOP
+	case 0x40: OP_LABEL( 40 ) // LD B,B
+	case 0x49: OP_LABEL( 49 ) // LD C,C
+	case 0x52: OP_LABEL( 52 ) // LD D,D
+	case 0x5B: OP_LABEL( 5B ) // LD E,E
+	case 0x64: OP_LABEL( 64 ) // LD H,H
+	case 0x6D: OP_LABEL( 6D ) // LD L,L
+	case 0x7F: OP_LABEL( 7F ) // LD A,A
 		goto loop;
 
 // CB Instructions
 
-	case 0xCB:
+	case 0xCB: OP_LABEL( CB )
 		pc++;
 		// now data is the opcode
 		switch ( data ) {
@@ -451,8 +494,8 @@ loop:
 	assert( false ); // unhandled CB op
 	// fallthrough
 
-	case 0x07: // RLCA
-	case 0x17: // RLA
+	case 0x07: OP_LABEL( 07 ) // RLCA
+	case 0x17: OP_LABEL( 17 ) // RLA
 		data = op;
 		op = rg.a;
 	rl_comm:
@@ -464,8 +507,8 @@ loop:
 		// SLA doesn't fill lower bit
 		goto shift_comm;
 
-	case 0x0F: // RRCA
-	case 0x1F: // RRA
+	case 0x0F: OP_LABEL( 0F ) // RRCA
+	case 0x1F: OP_LABEL( 1F ) // RRA
 		data = op;
 		op = rg.a;
 	rr_comm:
@@ -487,29 +530,29 @@ loop:
 
 // Load
 
-	case 0x70: // LD (HL),B
-	case 0x71: // LD (HL),C
-	case 0x72: // LD (HL),D
-	case 0x73: // LD (HL),E
-	case 0x74: // LD (HL),H
-	case 0x75: // LD (HL),L
-	case 0x77: // LD (HL),A
+	case 0x70: OP_LABEL( 70 ) // LD (HL),B
+	case 0x71: OP_LABEL( 71 ) // LD (HL),C
+	case 0x72: OP_LABEL( 72 ) // LD (HL),D
+	case 0x73: OP_LABEL( 73 ) // LD (HL),E
+	case 0x74: OP_LABEL( 74 ) // LD (HL),H
+	case 0x75: OP_LABEL( 75 ) // LD (HL),L
+	case 0x77: OP_LABEL( 77 ) // LD (HL),A
 		op = R8( op & 7 );
 	write_hl_op_ff:
 		WRITE( rp.hl, op & 0xFF );
 		goto loop;
 
-	case 0x41: case 0x42: case 0x43: case 0x44: case 0x45: case 0x47: // LD r,r
-	case 0x48: case 0x4A: case 0x4B: case 0x4C: case 0x4D: case 0x4F:
-	case 0x50: case 0x51: case 0x53: case 0x54: case 0x55: case 0x57:
-	case 0x58: case 0x59: case 0x5A: case 0x5C: case 0x5D: case 0x5F:
-	case 0x60: case 0x61: case 0x62: case 0x63: case 0x65: case 0x67:
-	case 0x68: case 0x69: case 0x6A: case 0x6B: case 0x6C: case 0x6F:
-	case 0x78: case 0x79: case 0x7A: case 0x7B: case 0x7C: case 0x7D:
+	case 0x41: OP_LABEL( 41 ) case 0x42: OP_LABEL( 42 ) case 0x43: OP_LABEL( 43 ) case 0x44: OP_LABEL( 44 ) case 0x45: OP_LABEL( 45 ) case 0x47: OP_LABEL( 47 ) // LD r,r
+	case 0x48: OP_LABEL( 48 ) case 0x4A: OP_LABEL( 4A ) case 0x4B: OP_LABEL( 4B ) case 0x4C: OP_LABEL( 4C ) case 0x4D: OP_LABEL( 4D ) case 0x4F: OP_LABEL( 4F )
+	case 0x50: OP_LABEL( 50 ) case 0x51: OP_LABEL( 51 ) case 0x53: OP_LABEL( 53 ) case 0x54: OP_LABEL( 54 ) case 0x55: OP_LABEL( 55 ) case 0x57: OP_LABEL( 57 )
+	case 0x58: OP_LABEL( 58 ) case 0x59: OP_LABEL( 59 ) case 0x5A: OP_LABEL( 5A ) case 0x5C: OP_LABEL( 5C ) case 0x5D: OP_LABEL( 5D ) case 0x5F: OP_LABEL( 5F )
+	case 0x60: OP_LABEL( 60 ) case 0x61: OP_LABEL( 61 ) case 0x62: OP_LABEL( 62 ) case 0x63: OP_LABEL( 63 ) case 0x65: OP_LABEL( 65 ) case 0x67: OP_LABEL( 67 )
+	case 0x68: OP_LABEL( 68 ) case 0x69: OP_LABEL( 69 ) case 0x6A: OP_LABEL( 6A ) case 0x6B: OP_LABEL( 6B ) case 0x6C: OP_LABEL( 6C ) case 0x6F: OP_LABEL( 6F )
+	case 0x78: OP_LABEL( 78 ) case 0x79: OP_LABEL( 79 ) case 0x7A: OP_LABEL( 7A ) case 0x7B: OP_LABEL( 7B ) case 0x7C: OP_LABEL( 7C ) case 0x7D: OP_LABEL( 7D )
 		R8( (op >> 3) & 7 ) = R8( op & 7 );
 		goto loop;
 
-	case 0x08: // LD IND16,SP
+	case 0x08: OP_LABEL( 08 ) // LD IND16,SP
 		data = GET_ADDR();
 		pc += 2;
 		WRITE( data, sp&0xFF );
@@ -517,51 +560,51 @@ loop:
 		WRITE( data, sp >> 8 );
 		goto loop;
 
-	case 0xF9: // LD SP,HL
+	case 0xF9: OP_LABEL( F9 ) // LD SP,HL
 		sp = rp.hl;
 		goto loop;
 
-	case 0x31: // LD SP,IMM
+	case 0x31: OP_LABEL( 31 ) // LD SP,IMM
 		sp = GET_ADDR();
 		pc += 2;
 		goto loop;
 
-	case 0x01: // LD BC,IMM
-	case 0x11: // LD DE,IMM
+	case 0x01: OP_LABEL( 01 ) // LD BC,IMM
+	case 0x11: OP_LABEL( 11 ) // LD DE,IMM
 		r16 [op >> 4] = GET_ADDR();
 		pc += 2;
 		goto loop;
 
 	{
 		unsigned temp;
-	case 0xE0: // LD (0xFF00+imm),A
+	case 0xE0: OP_LABEL( E0 ) // LD (0xFF00+imm),A
 		temp = data | 0xFF00;
 		pc++;
 		goto write_data_rg_a;
 
-	case 0xE2: // LD (0xFF00+C),A
+	case 0xE2: OP_LABEL( E2 ) // LD (0xFF00+C),A
 		temp = rg.c | 0xFF00;
 		goto write_data_rg_a;
 
-	case 0x32: // LD (HL-),A
+	case 0x32: OP_LABEL( 32 ) // LD (HL-),A
 		temp = rp.hl;
 		rp.hl = temp - 1;
 		goto write_data_rg_a;
 
-	case 0x02: // LD (BC),A
+	case 0x02: OP_LABEL( 02 ) // LD (BC),A
 		temp = rp.bc;
 		goto write_data_rg_a;
 
-	case 0x12: // LD (DE),A
+	case 0x12: OP_LABEL( 12 ) // LD (DE),A
 		temp = rp.de;
 		goto write_data_rg_a;
 
-	case 0x22: // LD (HL+),A
+	case 0x22: OP_LABEL( 22 ) // LD (HL+),A
 		temp = rp.hl;
 		rp.hl = temp + 1;
 		goto write_data_rg_a;
 
-	case 0xEA: // LD IND16,A (common)
+	case 0xEA: OP_LABEL( EA ) // LD IND16,A (common)
 		temp = GET_ADDR();
 		pc += 2;
 	write_data_rg_a:
@@ -569,102 +612,102 @@ loop:
 		goto loop;
 	}
 
-	case 0x06: // LD B,IMM
+	case 0x06: OP_LABEL( 06 ) // LD B,IMM
 		rg.b = data;
 		pc++;
 		goto loop;
 
-	case 0x0E: // LD C,IMM
+	case 0x0E: OP_LABEL( 0E ) // LD C,IMM
 		rg.c = data;
 		pc++;
 		goto loop;
 
-	case 0x16: // LD D,IMM
+	case 0x16: OP_LABEL( 16 ) // LD D,IMM
 		rg.d = data;
 		pc++;
 		goto loop;
 
-	case 0x1E: // LD E,IMM
+	case 0x1E: OP_LABEL( 1E ) // LD E,IMM
 		rg.e = data;
 		pc++;
 		goto loop;
 
-	case 0x26: // LD H,IMM
+	case 0x26: OP_LABEL( 26 ) // LD H,IMM
 		rg.h = data;
 		pc++;
 		goto loop;
 
-	case 0x2E: // LD L,IMM
+	case 0x2E: OP_LABEL( 2E ) // LD L,IMM
 		rg.l = data;
 		pc++;
 		goto loop;
 
-	case 0x36: // LD (HL),IMM
+	case 0x36: OP_LABEL( 36 ) // LD (HL),IMM
 		WRITE( rp.hl, data );
 		pc++;
 		goto loop;
 
-	case 0x3E: // LD A,IMM
+	case 0x3E: OP_LABEL( 3E ) // LD A,IMM
 		rg.a = data;
 		pc++;
 		goto loop;
 
 // Increment/Decrement
 
-	case 0x03: // INC BC
-	case 0x13: // INC DE
-	case 0x23: // INC HL
+	case 0x03: OP_LABEL( 03 ) // INC BC
+	case 0x13: OP_LABEL( 13 ) // INC DE
+	case 0x23: OP_LABEL( 23 ) // INC HL
 		r16 [op >> 4]++;
 		goto loop;
 
-	case 0x33: // INC SP
+	case 0x33: OP_LABEL( 33 ) // INC SP
 		sp = (sp + 1) & 0xFFFF;
 		goto loop;
 
-	case 0x0B: // DEC BC
-	case 0x1B: // DEC DE
-	case 0x2B: // DEC HL
+	case 0x0B: OP_LABEL( 0B ) // DEC BC
+	case 0x1B: OP_LABEL( 1B ) // DEC DE
+	case 0x2B: OP_LABEL( 2B ) // DEC HL
 		r16 [op >> 4]--;
 		goto loop;
 
-	case 0x3B: // DEC SP
+	case 0x3B: OP_LABEL( 3B ) // DEC SP
 		sp = (sp - 1) & 0xFFFF;
 		goto loop;
 
-	case 0x34: // INC (HL)
+	case 0x34: OP_LABEL( 34 ) // INC (HL)
 		op = rp.hl;
 		data = READ( op );
 		data++;
 		WRITE( op, data & 0xFF );
 		goto inc_comm;
 
-	case 0x04: // INC B
-	case 0x0C: // INC C (common)
-	case 0x14: // INC D
-	case 0x1C: // INC E
-	case 0x24: // INC H
-	case 0x2C: // INC L
-	case 0x3C: // INC A
+	case 0x04: OP_LABEL( 04 ) // INC B
+	case 0x0C: OP_LABEL( 0C ) // INC C (common)
+	case 0x14: OP_LABEL( 14 ) // INC D
+	case 0x1C: OP_LABEL( 1C ) // INC E
+	case 0x24: OP_LABEL( 24 ) // INC H
+	case 0x2C: OP_LABEL( 2C ) // INC L
+	case 0x3C: OP_LABEL( 3C ) // INC A
 		op = (op >> 3) & 7;
 		R8( op ) = data = R8( op ) + 1;
 	inc_comm:
 		flags = (flags & c_flag) | (((data & 15) - 1) & h_flag) | ((data >> 1) & z_flag);
 		goto loop;
 
-	case 0x35: // DEC (HL)
+	case 0x35: OP_LABEL( 35 ) // DEC (HL)
 		op = rp.hl;
 		data = READ( op );
 		data--;
 		WRITE( op, data & 0xFF );
 		goto dec_comm;
 
-	case 0x05: // DEC B
-	case 0x0D: // DEC C
-	case 0x15: // DEC D
-	case 0x1D: // DEC E
-	case 0x25: // DEC H
-	case 0x2D: // DEC L
-	case 0x3D: // DEC A
+	case 0x05: OP_LABEL( 05 ) // DEC B
+	case 0x0D: OP_LABEL( 0D ) // DEC C
+	case 0x15: OP_LABEL( 15 ) // DEC D
+	case 0x1D: OP_LABEL( 1D ) // DEC E
+	case 0x25: OP_LABEL( 25 ) // DEC H
+	case 0x2D: OP_LABEL( 2D ) // DEC L
+	case 0x3D: OP_LABEL( 3D ) // DEC A
 		op = (op >> 3) & 7;
 		data = R8( op ) - 1;
 		R8( op ) = data;
@@ -681,7 +724,7 @@ loop:
 		uint32_t temp; // need more than 16 bits for carry
 		unsigned prev;
 
-	case 0xF8: // LD HL,SP+imm
+	case 0xF8: OP_LABEL( F8 ) // LD HL,SP+imm
 		temp = int8_t (data); // sign-extend to 16 bits
 		pc++;
 		flags = 0;
@@ -689,7 +732,7 @@ loop:
 		prev = sp;
 		goto add_16_hl;
 
-	case 0xE8: // ADD SP,IMM
+	case 0xE8: OP_LABEL( E8 ) // ADD SP,IMM
 		temp = int8_t (data); // sign-extend to 16 bits
 		pc++;
 		flags = 0;
@@ -698,13 +741,13 @@ loop:
 		sp = temp & 0xFFFF;
 		goto add_16_comm;
 
-	case 0x39: // ADD HL,SP
+	case 0x39: OP_LABEL( 39 ) // ADD HL,SP
 		temp = sp;
 		goto add_hl_comm;
 
-	case 0x09: // ADD HL,BC
-	case 0x19: // ADD HL,DE
-	case 0x29: // ADD HL,HL
+	case 0x09: OP_LABEL( 09 ) // ADD HL,BC
+	case 0x19: OP_LABEL( 19 ) // ADD HL,DE
+	case 0x29: OP_LABEL( 29 ) // ADD HL,HL
 		temp = r16 [op >> 4];
 	add_hl_comm:
 		prev = rp.hl;
@@ -718,21 +761,21 @@ loop:
 		goto loop;
 	}
 
-	case 0x86: // ADD (HL)
+	case 0x86: OP_LABEL( 86 ) // ADD (HL)
 		data = READ( rp.hl );
 		goto add_comm;
 
-	case 0x80: // ADD B
-	case 0x81: // ADD C
-	case 0x82: // ADD D
-	case 0x83: // ADD E
-	case 0x84: // ADD H
-	case 0x85: // ADD L
-	case 0x87: // ADD A
+	case 0x80: OP_LABEL( 80 ) // ADD B
+	case 0x81: OP_LABEL( 81 ) // ADD C
+	case 0x82: OP_LABEL( 82 ) // ADD D
+	case 0x83: OP_LABEL( 83 ) // ADD E
+	case 0x84: OP_LABEL( 84 ) // ADD H
+	case 0x85: OP_LABEL( 85 ) // ADD L
+	case 0x87: OP_LABEL( 87 ) // ADD A
 		data = R8( op & 7 );
 		goto add_comm;
 
-	case 0xC6: // ADD IMM
+	case 0xC6: OP_LABEL( C6 ) // ADD IMM
 		pc++;
 	add_comm:
 		flags = rg.a;
@@ -747,42 +790,42 @@ loop:
 
 // Add/Subtract
 
-	case 0x8E: // ADC (HL)
+	case 0x8E: OP_LABEL( 8E ) // ADC (HL)
 		data = READ( rp.hl );
 		goto adc_comm;
 
-	case 0x88: // ADC B
-	case 0x89: // ADC C
-	case 0x8A: // ADC D
-	case 0x8B: // ADC E
-	case 0x8C: // ADC H
-	case 0x8D: // ADC L
-	case 0x8F: // ADC A
+	case 0x88: OP_LABEL( 88 ) // ADC B
+	case 0x89: OP_LABEL( 89 ) // ADC C
+	case 0x8A: OP_LABEL( 8A ) // ADC D
+	case 0x8B: OP_LABEL( 8B ) // ADC E
+	case 0x8C: OP_LABEL( 8C ) // ADC H
+	case 0x8D: OP_LABEL( 8D ) // ADC L
+	case 0x8F: OP_LABEL( 8F ) // ADC A
 		data = R8( op & 7 );
 		goto adc_comm;
 
-	case 0xCE: // ADC IMM
+	case 0xCE: OP_LABEL( CE ) // ADC IMM
 		pc++;
 	adc_comm:
 		data += (flags >> 4) & 1;
 		data &= 0xFF; // to do: does carry get set when sum + carry = 0x100?
 		goto add_comm;
 
-	case 0x96: // SUB (HL)
+	case 0x96: OP_LABEL( 96 ) // SUB (HL)
 		data = READ( rp.hl );
 		goto sub_comm;
 
-	case 0x90: // SUB B
-	case 0x91: // SUB C
-	case 0x92: // SUB D
-	case 0x93: // SUB E
-	case 0x94: // SUB H
-	case 0x95: // SUB L
-	case 0x97: // SUB A
+	case 0x90: OP_LABEL( 90 ) // SUB B
+	case 0x91: OP_LABEL( 91 ) // SUB C
+	case 0x92: OP_LABEL( 92 ) // SUB D
+	case 0x93: OP_LABEL( 93 ) // SUB E
+	case 0x94: OP_LABEL( 94 ) // SUB H
+	case 0x95: OP_LABEL( 95 ) // SUB L
+	case 0x97: OP_LABEL( 97 ) // SUB A
 		data = R8( op & 7 );
 		goto sub_comm;
 
-	case 0xD6: // SUB IMM
+	case 0xD6: OP_LABEL( D6 ) // SUB IMM
 		pc++;
 	sub_comm:
 		op = rg.a;
@@ -790,21 +833,21 @@ loop:
 		rg.a = data;
 		goto sub_set_flags;
 
-	case 0x9E: // SBC (HL)
+	case 0x9E: OP_LABEL( 9E ) // SBC (HL)
 		data = READ( rp.hl );
 		goto sbc_comm;
 
-	case 0x98: // SBC B
-	case 0x99: // SBC C
-	case 0x9A: // SBC D
-	case 0x9B: // SBC E
-	case 0x9C: // SBC H
-	case 0x9D: // SBC L
-	case 0x9F: // SBC A
+	case 0x98: OP_LABEL( 98 ) // SBC B
+	case 0x99: OP_LABEL( 99 ) // SBC C
+	case 0x9A: OP_LABEL( 9A ) // SBC D
+	case 0x9B: OP_LABEL( 9B ) // SBC E
+	case 0x9C: OP_LABEL( 9C ) // SBC H
+	case 0x9D: OP_LABEL( 9D ) // SBC L
+	case 0x9F: OP_LABEL( 9F ) // SBC A
 		data = R8( op & 7 );
 		goto sbc_comm;
 
-	case 0xDE: // SBC IMM
+	case 0xDE: OP_LABEL( DE ) // SBC IMM
 		pc++;
 	sbc_comm:
 		data += (flags >> 4) & 1;
@@ -813,59 +856,59 @@ loop:
 
 // Logical
 
-	case 0xA0: // AND B
-	case 0xA1: // AND C
-	case 0xA2: // AND D
-	case 0xA3: // AND E
-	case 0xA4: // AND H
-	case 0xA5: // AND L
+	case 0xA0: OP_LABEL( A0 ) // AND B
+	case 0xA1: OP_LABEL( A1 ) // AND C
+	case 0xA2: OP_LABEL( A2 ) // AND D
+	case 0xA3: OP_LABEL( A3 ) // AND E
+	case 0xA4: OP_LABEL( A4 ) // AND H
+	case 0xA5: OP_LABEL( A5 ) // AND L
 		data = R8( op & 7 );
 		goto and_comm;
 
-	case 0xA6: // AND (HL)
+	case 0xA6: OP_LABEL( A6 ) // AND (HL)
 		data = READ( rp.hl );
 		pc--; // FALLTHRU
-	case 0xE6: // AND IMM
+	case 0xE6: OP_LABEL( E6 ) // AND IMM
 		pc++;
 	and_comm:
 		rg.a &= data; // FALLTHRU
-	case 0xA7: // AND A
+	case 0xA7: OP_LABEL( A7 ) // AND A
 		flags = h_flag | (((rg.a - 1) >> 1) & z_flag);
 		goto loop;
 
-	case 0xB0: // OR B
-	case 0xB1: // OR C
-	case 0xB2: // OR D
-	case 0xB3: // OR E
-	case 0xB4: // OR H
-	case 0xB5: // OR L
+	case 0xB0: OP_LABEL( B0 ) // OR B
+	case 0xB1: OP_LABEL( B1 ) // OR C
+	case 0xB2: OP_LABEL( B2 ) // OR D
+	case 0xB3: OP_LABEL( B3 ) // OR E
+	case 0xB4: OP_LABEL( B4 ) // OR H
+	case 0xB5: OP_LABEL( B5 ) // OR L
 		data = R8( op & 7 );
 		goto or_comm;
 
-	case 0xB6: // OR (HL)
+	case 0xB6: OP_LABEL( B6 ) // OR (HL)
 		data = READ( rp.hl );
 		pc--; // FALLTHRU
-	case 0xF6: // OR IMM
+	case 0xF6: OP_LABEL( F6 ) // OR IMM
 		pc++;
 	or_comm:
 		rg.a |= data; // FALLTHRU
-	case 0xB7: // OR A
+	case 0xB7: OP_LABEL( B7 ) // OR A
 		flags = ((rg.a - 1) >> 1) & z_flag;
 		goto loop;
 
-	case 0xA8: // XOR B
-	case 0xA9: // XOR C
-	case 0xAA: // XOR D
-	case 0xAB: // XOR E
-	case 0xAC: // XOR H
-	case 0xAD: // XOR L
+	case 0xA8: OP_LABEL( A8 ) // XOR B
+	case 0xA9: OP_LABEL( A9 ) // XOR C
+	case 0xAA: OP_LABEL( AA ) // XOR D
+	case 0xAB: OP_LABEL( AB ) // XOR E
+	case 0xAC: OP_LABEL( AC ) // XOR H
+	case 0xAD: OP_LABEL( AD ) // XOR L
 		data = R8( op & 7 );
 		goto xor_comm;
 
-	case 0xAE: // XOR (HL)
+	case 0xAE: OP_LABEL( AE ) // XOR (HL)
 		data = READ( rp.hl );
 		pc--; // FALLTHRU
-	case 0xEE: // XOR IMM
+	case 0xEE: OP_LABEL( EE ) // XOR IMM
 		pc++;
 	xor_comm:
 		data ^= rg.a;
@@ -874,17 +917,17 @@ loop:
 		flags = (data >> 1) & z_flag;
 		goto loop;
 
-	case 0xAF: // XOR A
+	case 0xAF: OP_LABEL( AF ) // XOR A
 		rg.a = 0;
 		flags = z_flag;
 		goto loop;
 
 // Stack
 
-	case 0xF1: // POP AF
-	case 0xC1: // POP BC
-	case 0xD1: // POP DE
-	case 0xE1: // POP HL (common)
+	case 0xF1: OP_LABEL( F1 ) // POP AF
+	case 0xC1: OP_LABEL( C1 ) // POP BC
+	case 0xD1: OP_LABEL( D1 ) // POP DE
+	case 0xE1: OP_LABEL( E1 ) // POP HL (common)
 		data = READ( sp );
 		r16 [(op >> 4) & 3] = data + 0x100 * READ( sp + 1 );
 		sp = (sp + 2) & 0xFFFF;
@@ -894,95 +937,95 @@ loop:
 		rg.a = rg.flags;
 		goto loop;
 
-	case 0xC5: // PUSH BC
+	case 0xC5: OP_LABEL( C5 ) // PUSH BC
 		data = rp.bc;
 		goto push;
 
-	case 0xD5: // PUSH DE
+	case 0xD5: OP_LABEL( D5 ) // PUSH DE
 		data = rp.de;
 		goto push;
 
-	case 0xE5: // PUSH HL
+	case 0xE5: OP_LABEL( E5 ) // PUSH HL
 		data = rp.hl;
 		goto push;
 
-	case 0xF5: // PUSH AF
+	case 0xF5: OP_LABEL( F5 ) // PUSH AF
 		data = (rg.a << 8) | flags;
 		goto push;
 
 // Flow control
 
-	case 0xFF:
+	case 0xFF: OP_LABEL( FF )
 		if ( pc == idle_addr + 1 )
 			goto stop;
 		// FALLTHRU
-	case 0xC7: case 0xCF: case 0xD7: case 0xDF:  // RST
-	case 0xE7: case 0xEF: case 0xF7:
+	case 0xC7: OP_LABEL( C7 ) case 0xCF: OP_LABEL( CF ) case 0xD7: OP_LABEL( D7 ) case 0xDF: OP_LABEL( DF )  // RST
+	case 0xE7: OP_LABEL( E7 ) case 0xEF: OP_LABEL( EF ) case 0xF7: OP_LABEL( F7 )
 		data = pc;
 		pc = (op & 0x38) + rst_base;
 		goto push;
 
-	case 0xCC: // CZ
+	case 0xCC: OP_LABEL( CC ) // CZ
 		pc += 2;
 		if ( flags & z_flag )
 			goto call;
 		goto loop;
 
-	case 0xD4: // CNC
+	case 0xD4: OP_LABEL( D4 ) // CNC
 		pc += 2;
 		if ( !(flags & c_flag) )
 			goto call;
 		goto loop;
 
-	case 0xDC: // CC
+	case 0xDC: OP_LABEL( DC ) // CC
 		pc += 2;
 		if ( flags & c_flag )
 			goto call;
 		goto loop;
 
-	case 0xD9: // RETI
+	case 0xD9: OP_LABEL( D9 ) // RETI
 		//interrupts_enabled = 1;
 		goto ret;
 
-	case 0xC0: // RZ
+	case 0xC0: OP_LABEL( C0 ) // RZ
 		if ( !(flags & z_flag) )
 			goto ret;
 		goto loop;
 
-	case 0xD0: // RNC
+	case 0xD0: OP_LABEL( D0 ) // RNC
 		if ( !(flags & c_flag) )
 			goto ret;
 		goto loop;
 
-	case 0xD8: // RC
+	case 0xD8: OP_LABEL( D8 ) // RC
 		if ( flags & c_flag )
 			goto ret;
 		goto loop;
 
-	case 0x18: // JR
+	case 0x18: OP_LABEL( 18 ) // JR
 		BRANCH( true )
 
-	case 0x30: // JR NC
+	case 0x30: OP_LABEL( 30 ) // JR NC
 		BRANCH( !(flags & c_flag) )
 
-	case 0x38: // JR C
+	case 0x38: OP_LABEL( 38 ) // JR C
 		BRANCH( flags & c_flag )
 
-	case 0xE9: // JP_HL
+	case 0xE9: OP_LABEL( E9 ) // JP_HL
 		pc = rp.hl;
 		goto loop;
 
-	case 0xC3: // JP (next-most-common)
+	case 0xC3: OP_LABEL( C3 ) // JP (next-most-common)
 		pc = GET_ADDR();
 		goto loop;
 
-	case 0xC2: // JP NZ
+	case 0xC2: OP_LABEL( C2 ) // JP NZ
 		pc += 2;
 		if ( !(flags & z_flag) )
 			goto jp_taken;
 		goto loop;
 
-	case 0xCA: // JP Z (most common)
+	case 0xCA: OP_LABEL( CA ) // JP Z (most common)
 		pc += 2;
 		if ( !(flags & z_flag) )
 			goto loop;
@@ -991,13 +1034,13 @@ loop:
 		pc = GET_ADDR();
 		goto loop;
 
-	case 0xD2: // JP NC
+	case 0xD2: OP_LABEL( D2 ) // JP NC
 		pc += 2;
 		if ( !(flags & c_flag) )
 			goto jp_taken;
 		goto loop;
 
-	case 0xDA: // JP C
+	case 0xDA: OP_LABEL( DA ) // JP C
 		pc += 2;
 		if ( flags & c_flag )
 			goto jp_taken;
@@ -1005,37 +1048,37 @@ loop:
 
 // Flags
 
-	case 0x2F: // CPL
+	case 0x2F: OP_LABEL( 2F ) // CPL
 		rg.a = ~rg.a;
 		flags |= n_flag | h_flag;
 		goto loop;
 
-	case 0x3F: // CCF
+	case 0x3F: OP_LABEL( 3F ) // CCF
 		flags = (flags ^ c_flag) & ~(n_flag | h_flag);
 		goto loop;
 
-	case 0x37: // SCF
+	case 0x37: OP_LABEL( 37 ) // SCF
 		flags = (flags | c_flag) & ~(n_flag | h_flag);
 		goto loop;
 
-	case 0xF3: // DI
+	case 0xF3: OP_LABEL( F3 ) // DI
 		//interrupts_enabled = 0;
 		goto loop;
 
-	case 0xFB: // EI
+	case 0xFB: OP_LABEL( FB ) // EI
 		//interrupts_enabled = 1;
 		goto loop;
 
 // Special
 
-	case 0xDD: case 0xD3: case 0xDB: case 0xE3: case 0xE4: // ?
-	case 0xEB: case 0xEC: case 0xF4: case 0xFD: case 0xFC:
-	case 0x10: // STOP
-	case 0x27: // DAA (I'll have to implement this eventually...)
-	case 0xBF:
-	case 0xED: // Z80 prefix
-	case 0x76: // HALT
-		s.remain++;
+	case 0xDD: OP_LABEL( DD ) case 0xD3: OP_LABEL( D3 ) case 0xDB: OP_LABEL( DB ) case 0xE3: OP_LABEL( E3 ) case 0xE4: OP_LABEL( E4 ) // ?
+	case 0xEB: OP_LABEL( EB ) case 0xEC: OP_LABEL( EC ) case 0xF4: OP_LABEL( F4 ) case 0xFD: OP_LABEL( FD ) case 0xFC: OP_LABEL( FC )
+	case 0x10: OP_LABEL( 10 ) // STOP
+	case 0x27: OP_LABEL( 27 ) // DAA (I'll have to implement this eventually...)
+	case 0xBF: OP_LABEL( BF )
+	case 0xED: OP_LABEL( ED ) // Z80 prefix
+	case 0x76: OP_LABEL( 76 ) // HALT
+		s_remain++;
 		goto stop;
 	}
 
@@ -1044,6 +1087,7 @@ loop:
 
 stop:
 	pc--;
+	s.remain = s_remain;
 
 	// copy state back
 	STATIC_CAST(core_regs_t&,r) = rg;
@@ -20,10 +20,12 @@ Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA */
 
 double const min_tempo = 0.25;
 double const oversample_factor = 5 / 3.0;
+double const draft_oversample_factor = 0.5; // FM at half the output rate, if faster
 double const fm_gain = 3.0;
 
 const long base_clock = 53700300;
 const long clock_rate = base_clock / 15;
+const long fm_native_rate = long (base_clock / 7 / 144.0 + 0.5); // YM2612's own sample rate
 
 Gym_Emu::Gym_Emu()
 {
@@ -156,6 +158,8 @@ struct Gym_File : Gme_Info_
 		get_gym_info( *(Gym_Emu::header_t const*) file_begin, length, out );
 		return 0;
 	}
+
+	long preferred_sample_rate_() const { return fm_native_rate; }
 };
 
 static Music_Emu* new_gym_emu () { return BLARGG_NEW Gym_Emu ; }
@@ -173,18 +177,34 @@ blargg_err_t Gym_Emu::set_sample_rate_( long sample_rate )
 	dac_synth.treble_eq( eq );
 	apu.volume( 0.135 * fm_gain * gain() );
 	dac_synth.volume( 0.125 / 256 * fm_gain * gain() );
-	double factor = Dual_Resampler::setup( oversample_factor, 0.990, fm_gain * gain() );
-	fm_sample_rate = sample_rate * factor;
 
 	RETURN_ERR( blip_buf.set_sample_rate( sample_rate, int (1000 / 60.0 / min_tempo) ) );
 	blip_buf.clock_rate( clock_rate );
 
+	return setup_fm();
+}
+
+blargg_err_t Gym_Emu::setup_fm()
+{
+	long const sample_rate = blip_buf.sample_rate();
+	bool const draft = (quality() == gme_quality_draft);
+	Dual_Resampler::draft_resampling( draft );
+	double oversample = oversample_factor;
+	if ( sample_rate == fm_native_rate )
+		oversample = 1.0; // run FM at its own rate and don't resample it
+	if ( draft && ym2612_rate_saves_time )
+		oversample = draft_oversample_factor;
+	double factor = Dual_Resampler::setup( oversample, 0.990, fm_gain * gain() );
+	fm_sample_rate = sample_rate * factor;
+
 	RETURN_ERR( fm.set_rate( fm_sample_rate, base_clock / 7.0 ) );
 	RETURN_ERR( Dual_Resampler::reset( long (1.0 / 60 / min_tempo * sample_rate) ) );
 
 	return 0;
 }
 
+long Gym_Emu::preferred_sample_rate_() const { return fm_native_rate; }
+
 void Gym_Emu::set_tempo_( double t )
 {
 	if ( t < min_tempo )
@@ -223,6 +243,10 @@ blargg_err_t Gym_Emu::load_mem_( byte const* in, long size )
 		header_ = *(header_t const*) in;
 	else
 		blarg_memset( &header_, 0, sizeof header_ );
+
+	// quality may have changed since sample rate was set
+	RETURN_ERR( setup_fm() );
+	set_tempo_( tempo() ); // setup_fm() sized frames for min_tempo
 	return 0;
 }
 
@@ -316,6 +340,7 @@ void Gym_Emu::parse_frame()
 				if ( data == 0x2B )
 					dac_enabled = (data2 & 0x80) != 0;
 
+				count_apu_write();
 				fm.write0( data, data2 );
 			}
 			else if ( dac_count < (int) sizeof dac_buf )
@@ -326,10 +351,12 @@ void Gym_Emu::parse_frame()
 		}
 		else if ( cmd == 2 )
 		{
+			count_apu_write();
 			fm.write1( data, *pos++ );
 		}
 		else if ( cmd == 3 )
 		{
+			count_apu_write();
 			apu.write_data( 0, data );
 		}
 		else
@@ -374,6 +401,6 @@ int Gym_Emu::play_frame( blip_time_t blip_time, int sample_count, sample_t* buf
 
 blargg_err_t Gym_Emu::play_( long count, sample_t* out )
 {
-	Dual_Resampler::dual_play( count, out, blip_buf );
+	Dual_Resampler::dual_play( count, out, blip_buf, emu_stats() );
 	return 0;
 }
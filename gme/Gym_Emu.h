@@ -51,6 +51,7 @@ protected:
 	blargg_err_t play_( long count, sample_t* );
 	void mute_voices_( int );
 	void set_tempo_( double );
+	long preferred_sample_rate_() const;
 	int play_frame( blip_time_t blip_time, int sample_count, sample_t* buf );
 private:
 	// sequence data begin, loop begin, current position, end
@@ -77,6 +78,7 @@ private:
 	Blip_Synth<blip_med_quality,1> dac_synth;
 	Sms_Apu apu;
 	byte dac_buf [1024];
+	blargg_err_t setup_fm();
 };
 
 #endif
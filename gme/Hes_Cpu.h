@@ -54,6 +54,9 @@ public:
 
 	void end_frame( hes_time_t );
 
+	// Number of clocks spent in idle loops that were skipped rather than emulated
+	int64_t skipped_clocks() const { return skipped_clocks_; }
+
 	// Attempt to execute instruction here results in CPU advancing time to
 	// lesser of irq_time() and end_time() (or end_time() if IRQs are
 	// disabled)
@@ -79,9 +82,13 @@ private:
 	state_t state_;
 	hes_time_t irq_time_;
 	hes_time_t end_time_;
+	int64_t skipped_clocks_;
 
 	void set_code_page( int, void const* );
 	inline int update_end_time( hes_time_t end, hes_time_t irq );
+
+	struct policy;
+	template<class P> friend class Cpu_6502;
 };
 
 inline uint8_t const* Hes_Cpu::get_code( hes_addr_t addr )
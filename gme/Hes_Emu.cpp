@@ -302,6 +302,7 @@ void Hes_Emu::cpu_write_( hes_addr_t addr, int data )
 		GME_APU_HOOK( this, addr - apu.start_addr, data );
 		// avoid going way past end when a long block xfer is writing to I/O space
 		hes_time_t t = min( time(), end_time() + 8 );
+		count_apu_write();
 		apu.write_data( t, addr, data );
 		return;
 	}
@@ -503,7 +504,7 @@ int Hes_Emu::cpu_done()
 			return 0x08;
 		}
 	}
-	return 0;
+	return -1;
 }
 
 static void adjust_time( int32_t& time, hes_time_t delta )
@@ -516,6 +517,11 @@ static void adjust_time( int32_t& time, hes_time_t delta )
 	}
 }
 
+int64_t Hes_Emu::idle_clocks_() const
+{
+	return cpu::skipped_clocks();
+}
+
 blargg_err_t Hes_Emu::run_clocks( blip_time_t& duration_, int )
 {
 	blip_time_t const duration = duration_; // cache
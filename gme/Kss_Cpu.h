@@ -37,6 +37,10 @@ public:
 	void set_time( cpu_time_t t )       { state->time = t - state->base; }
 	void adjust_time( int delta )       { state->time += delta; }
 
+	// Number of clocks spent in idle loops and HALT that were skipped rather
+	// than emulated
+	int64_t skipped_clocks() const { return skipped_clocks_; }
+
 	#if BLARGG_BIG_ENDIAN
 		struct regs_t { uint8_t b, c, d, e, h, l, flags, a; };
 	#else
@@ -78,8 +82,8 @@ public:
 	enum { page_shift = 13 };
 	enum { page_count = 0x10000 >> page_shift };
 private:
-	uint8_t szpc [0x200];
 	cpu_time_t end_time_;
+	int64_t skipped_clocks_;
 	struct state_t {
 		uint8_t const* read  [page_count + 1];
 		uint8_t      * write [page_count + 1];
@@ -307,6 +307,7 @@ void Kss_Emu::cpu_write( unsigned addr, int data )
 	if ( scc_addr < scc.reg_count )
 	{
 		scc_accessed = true;
+		count_apu_write();
 		scc.write( time(), scc_addr, data );
 		return;
 	}
@@ -333,6 +334,7 @@ void kss_cpu_out( Kss_Cpu* cpu, cpu_time_t time, unsigned addr, int data )
 
 	case 0xA1:
 		GME_APU_HOOK( &emu, emu.ay_latch, data );
+		emu.count_apu_write();
 		emu.ay.write( time, emu.ay_latch, data );
 		return;
 
@@ -349,6 +351,7 @@ void kss_cpu_out( Kss_Cpu* cpu, cpu_time_t time, unsigned addr, int data )
 		if ( emu.sn )
 		{
 			GME_APU_HOOK( &emu, 16, data );
+			emu.count_apu_write();
 			emu.sn->write_data( time, data );
 			return;
 		}
@@ -384,6 +387,11 @@ int kss_cpu_in( Kss_Cpu*, cpu_time_t, unsigned addr )
 
 // Emulation
 
+int64_t Kss_Emu::idle_clocks_() const
+{
+	return cpu::skipped_clocks();
+}
+
 blargg_err_t Kss_Emu::run_clocks( blip_time_t& duration, int )
 {
 	while ( time() < duration )
@@ -2,6 +2,7 @@
 
 #include "Multi_Buffer.h"
 
+#include <string.h>
 
 #if defined(_MSC_VER)
 	#pragma warning(disable:4244) /* loss of data int8<->int16 conversion */
@@ -119,15 +120,20 @@ long Stereo_Buffer::read_samples( blip_sample_t* out, long count )
 	if ( count )
 	{
 		int bufs_used = stereo_added | was_stereo;
+		if ( !bufs [1].non_silent() && !bufs [2].non_silent() )
+			bufs_used &= 1;
 		//debug_printf( "%X\n", bufs_used );
 		if ( bufs_used <= 1 )
 		{
-			mix_mono( out, count );
+			if ( bufs [0].non_silent() )
+				mix_mono( out, count );
+			else
+				blarg_memset( out, 0, count * 2 * sizeof *out );
 			bufs [0].remove_samples( count );
 			bufs [1].remove_silence( count );
 			bufs [2].remove_silence( count );
 		}
-		else if ( bufs_used & 1 )
+		else if ( (bufs_used & 1) && bufs [0].non_silent() )
 		{
 			mix_stereo( out, count );
 			bufs [0].remove_samples( count );
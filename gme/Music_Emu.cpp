@@ -3,6 +3,7 @@
 #include "Music_Emu.h"
 
 #include "Multi_Buffer.h"
+#include "blargg_simd.h"
 #include <string.h>
 #include <algorithm>
 
@@ -23,6 +24,9 @@ int const silence_max = 6; // seconds
 int const silence_threshold = 0x10;
 long const fade_block_size = 512;
 int const fade_shift = 8; // fade ends with gain at 1.0 / (1 << fade_shift)
+int const fade_gain_shift = 14; // fade gain of 1.0
+long const max_fade_gains = 0x4000; // longer fades compute the rest as needed
+long const max_skip = 0x40000000; // keeps skip() counts within a 32-bit long
 
 #ifndef min
 #define min(x,y) ((x > y) ? y : x)
@@ -48,11 +52,15 @@ void Music_Emu::clear_track_vars()
 	emu_time         = 0;
 	emu_track_ended_ = true;
 	track_ended_     = true;
-	fade_start       = INT_MAX / 2 + 1;
+	fade_start       = (int64_t) 1 << 62; // after any track
 	fade_step        = 1;
+	fade_gain_count  = 0;
+	track_end_time   = -1;
 	silence_time     = 0;
 	silence_count    = 0;
 	buf_remain       = 0;
+	silence_pending  = false;
+	stats_.clear();
 	warning(); // clear warning
 }
 
@@ -71,6 +79,7 @@ Music_Emu::Music_Emu()
 	mute_mask_   = 0;
 	tempo_       = 1.0;
 	gain_        = 1.0;
+	quality_     = gme_quality_normal;
 
 	// defaults
 	max_initial_silence = 2;
@@ -81,6 +90,11 @@ Music_Emu::Music_Emu()
 
 	emu_autoload_playback_limit_ = true;
 
+	for ( unsigned i = 0; i < control_count; i++ )
+		control_seqs [i].store( i, std::memory_order_relaxed );
+	control_head.store( 0, std::memory_order_relaxed );
+	control_tail = 0;
+
 	static const char* const names [] = {
 		"Voice 1", "Voice 2", "Voice 3", "Voice 4",
 		"Voice 5", "Voice 6", "Voice 7", "Voice 8"
@@ -175,6 +189,16 @@ void Music_Emu::disable_echo( bool disable )
 	disable_echo_( disable );
 }
 
+blargg_err_t Music_Emu::set_quality( int q )
+{
+	if ( track_count() )
+		return "Quality must be set before loading a file";
+	if ( q < gme_quality_draft ) q = gme_quality_draft;
+	if ( q > gme_quality_high  ) q = gme_quality_high;
+	quality_ = q;
+	return 0;
+}
+
 void Music_Emu::set_tempo( double t )
 {
 	require( sample_rate() ); // sample rate must be set first
@@ -186,6 +210,107 @@ void Music_Emu::set_tempo( double t )
 	set_tempo_( t );
 }
 
+// Thread-safe control
+
+enum { control_mute, control_tempo, control_eq, control_echo, control_fade };
+
+blargg_err_t Music_Emu::post_control( control_t const& c )
+{
+	unsigned pos = control_head.load( std::memory_order_relaxed );
+	for ( ;; )
+	{
+		int lap = (int) (control_seqs [pos & (control_count - 1)].load(
+				std::memory_order_acquire ) - pos);
+		if ( lap < 0 )
+			return "Too many control changes pending";
+
+		// slot is free if its sequence has caught up to pos; otherwise another
+		// thread just claimed it
+		if ( lap == 0 && control_head.compare_exchange_weak( pos, pos + 1,
+				std::memory_order_relaxed ) )
+			break;
+		if ( lap != 0 )
+			pos = control_head.load( std::memory_order_relaxed );
+	}
+
+	controls [pos & (control_count - 1)] = c;
+	control_seqs [pos & (control_count - 1)].store( pos + 1, std::memory_order_release );
+	return 0;
+}
+
+void Music_Emu::apply_controls()
+{
+	for ( ;; )
+	{
+		unsigned const pos = control_tail;
+		int const i = pos & (control_count - 1);
+		if ( control_seqs [i].load( std::memory_order_acquire ) != pos + 1 )
+			break;
+
+		control_t const c = controls [i];
+		control_seqs [i].store( pos + control_count, std::memory_order_release );
+		control_tail = pos + 1;
+
+		switch ( c.type )
+		{
+		case control_mute:  mute_voices( c.mask );              break;
+		case control_tempo: set_tempo( c.tempo );               break;
+		case control_eq:    set_equalizer( c.eq );              break;
+		case control_echo:  disable_echo( c.mask != 0 );        break;
+		case control_fade:  set_fade( c.start, c.length );      break;
+		}
+	}
+}
+
+blargg_err_t Music_Emu::post_mute_voices( int mask )
+{
+	control_t c = control_t();
+	c.type = control_mute;
+	c.mask = mask;
+	return post_control( c );
+}
+
+blargg_err_t Music_Emu::post_tempo( double t )
+{
+	control_t c = control_t();
+	c.type  = control_tempo;
+	c.tempo = t;
+	return post_control( c );
+}
+
+blargg_err_t Music_Emu::post_equalizer( equalizer_t const& eq )
+{
+	control_t c = control_t();
+	c.type = control_eq;
+	c.eq   = eq;
+	return post_control( c );
+}
+
+blargg_err_t Music_Emu::post_disable_echo( bool disable )
+{
+	control_t c = control_t();
+	c.type = control_echo;
+	c.mask = disable;
+	return post_control( c );
+}
+
+blargg_err_t Music_Emu::post_fade( long start_msec, long length_msec )
+{
+	control_t c = control_t();
+	c.type   = control_fade;
+	c.start  = start_msec;
+	c.length = length_msec;
+	return post_control( c );
+}
+
+// Performance statistics
+
+void Music_Emu::get_stats( stats_t* out ) const
+{
+	*out = stats_.counts;
+	out->cpu_idle_clocks = idle_clocks_();
+}
+
 void Music_Emu::post_load_()
 {
 	set_tempo( tempo_ );
@@ -193,6 +318,13 @@ void Music_Emu::post_load_()
 }
 
 blargg_err_t Music_Emu::start_track( int track )
+{
+	RETURN_ERR( start_track_deferred( track ) );
+	skip_initial_silence( initial_silence_limit() );
+	return track_ended() ? warning() : 0;
+}
+
+blargg_err_t Music_Emu::start_track_deferred( int track )
 {
 	clear_track_vars();
 
@@ -203,24 +335,32 @@ blargg_err_t Music_Emu::start_track( int track )
 
 	emu_track_ended_ = false;
 	track_ended_     = false;
+	silence_pending  = !ignore_silence_;
+	return 0;
+}
 
-	if ( !ignore_silence_ )
+void Music_Emu::skip_initial_silence( long count )
+{
+	if ( !silence_pending )
+		return;
+
+	// play until non-silence, end of track, or limit
+	for ( long n = 0; emu_time < initial_silence_limit(); n += buf_size )
 	{
-		// play until non-silence or end of track
-		for ( long end = max_initial_silence * out_channels() * sample_rate(); emu_time < end; )
-		{
-			fill_buf();
-			if ( buf_remain | (int) emu_track_ended_ )
-				break;
-		}
+		if ( n >= count )
+			return; // not done yet
 
-		emu_time        = buf_remain;
-		out_time        = 0;
-		out_time_scaled = 0;
-		silence_time    = 0;
-		silence_count   = 0;
+		fill_buf();
+		if ( buf_remain | (int) emu_track_ended_ )
+			break;
 	}
-	return track_ended() ? warning() : 0;
+
+	emu_time        = buf_remain;
+	out_time        = 0;
+	out_time_scaled = 0;
+	silence_time    = 0;
+	silence_count   = 0;
+	silence_pending = false;
 }
 
 void Music_Emu::end_track_if_error( blargg_err_t err )
@@ -244,59 +384,102 @@ void Music_Emu::set_autoload_playback_limit( bool do_autoload_limit )
 
 // Tell/Seek
 
-int32_t Music_Emu::msec_to_samples( int32_t msec ) const
+int64_t Music_Emu::msec_to_samples( int64_t msec ) const
 {
-	int32_t sec = msec / 1000;
+	int64_t sec = msec / 1000;
 	msec -= sec * 1000;
 	return (sec * sample_rate() + msec * sample_rate() / 1000) * out_channels();
 }
 
-long Music_Emu::tell_samples() const
+int64_t Music_Emu::tell_samples64() const
 {
 	return out_time;
 }
 
-long Music_Emu::tell() const
+int64_t Music_Emu::tell64() const
 {
 	int32_t rate = sample_rate() * out_channels();
-	int32_t sec = out_time / rate;
+	int64_t sec = out_time / rate;
 	return sec * 1000 + (out_time - sec * rate) * 1000 / rate;
 }
 
+long Music_Emu::tell_samples() const
+{
+	return (long) tell_samples64();
+}
+
+long Music_Emu::tell() const
+{
+	return (long) tell64();
+}
+
+int64_t Music_Emu::tell_scaled64() const
+{
+	return (int64_t)(out_time_scaled / (sample_rate() / 1000.0));
+}
+
 long Music_Emu::tell_scaled() const
 {
-	return (long)(out_time_scaled / (sample_rate() / 1000.0));
+	return (long) tell_scaled64();
 }
 
-blargg_err_t Music_Emu::seek_samples( long time )
+blargg_err_t Music_Emu::seek_samples64( int64_t time )
 {
 	if ( time < out_time )
 		RETURN_ERR( start_track( current_track_ ) );
-	return skip( time - out_time );
+
+	int64_t remain = time - out_time;
+	while ( remain > max_skip )
+	{
+		RETURN_ERR( skip( max_skip ) );
+		remain -= max_skip;
+	}
+	return skip( (long) remain );
+}
+
+blargg_err_t Music_Emu::seek64( int64_t msec )
+{
+	return seek_samples64( msec_to_samples( msec ) );
+}
+
+blargg_err_t Music_Emu::seek_samples( long time )
+{
+	return seek_samples64( time );
 }
 
 blargg_err_t Music_Emu::seek( long msec )
 {
-	return seek_samples( msec_to_samples( msec ) );
+	return seek64( msec );
 }
 
-blargg_err_t Music_Emu::seek_scaled( long msec )
+blargg_err_t Music_Emu::seek_scaled64( int64_t msec )
 {
 	require( tempo_ > 0 );
-	int32_t frames = (int32_t)((msec / 1000.0) * sample_rate());
+	int64_t frames = (int64_t)((msec / 1000.0) * sample_rate());
 	if ( frames < out_time_scaled )
 		RETURN_ERR( start_track( current_track_ ) );
-	int samples_to_skip = (int)
+	int64_t samples_to_skip = (int64_t)
 		((frames - out_time_scaled) * out_channels() / tempo_);
 	samples_to_skip += samples_to_skip % out_channels();
-	return skip( samples_to_skip );
+	return seek_samples64( out_time + samples_to_skip );
+}
+
+blargg_err_t Music_Emu::seek_scaled( long msec )
+{
+	return seek_scaled64( msec );
 }
 
 blargg_err_t Music_Emu::skip( long count )
 {
 	require( current_track() >= 0 ); // start_track() must have been called already
+	Emu_Stats_Timer timer( stats_, stats_.counts.play_nsec );
+	apply_controls();
+	if ( silence_pending )
+		skip_initial_silence( initial_silence_limit() );
+
+	stats_.counts.samples_played += count;
 	out_time += count;
-	out_time_scaled += (int32_t)(count * tempo_ / out_channels());
+	out_time_scaled += (int64_t)(count * tempo_ / out_channels());
 
 	// remove from silence and buf first
 	{
@@ -311,12 +494,17 @@ blargg_err_t Music_Emu::skip( long count )
 
 	if ( count && !emu_track_ended_ )
 	{
+		Emu_Stats_Timer timer( stats_, stats_.counts.emulate_nsec );
+		stats_.counts.samples_emulated += count;
 		emu_time += count;
 		end_track_if_error( skip_( count ) );
 	}
 
 	if ( !(silence_count | buf_remain) ) // caught up to emulator, so update track ended
-		track_ended_ |= emu_track_ended_;
+		track_ended_ = track_ended_ || emu_track_ended_;
+
+	if ( track_ended_ && track_end_time < 0 )
+		track_end_time = out_time;
 
 	return 0;
 }
@@ -352,10 +540,27 @@ blargg_err_t Music_Emu::skip_( long count )
 
 // Fading
 
+static int int_log( int32_t x, int step, int unit );
+
 void Music_Emu::set_fade( long start_msec, long length_msec )
 {
 	fade_step = sample_rate() * length_msec / (fade_block_size * fade_shift * 1000 / out_channels());
 	fade_start = msec_to_samples( start_msec );
+
+	// tabulate gain of each block through the end of the fade, so play()
+	// doesn't have to divide for every block
+	int const unit = 1 << fade_gain_shift;
+	long count = min( (long) fade_step * fade_shift + 2, max_fade_gains );
+	if ( fade_gains.size() < (size_t) count && fade_gains.resize( count ) )
+		count = 0; // out of memory; compute gains as needed
+	fade_gain_count = 0;
+	while ( fade_gain_count < count )
+	{
+		int gain = int_log( fade_gain_count, fade_step, unit );
+		fade_gains [fade_gain_count++] = gain;
+		if ( gain < (unit >> fade_shift) )
+			break;
+	}
 }
 
 // unit / pow( 2.0, (double) x / step )
@@ -376,23 +581,46 @@ static int int_log( int32_t x, int step, int unit )
 	return ((unit - fraction) + (fraction >> 1)) >> shift;
 }
 
+// Scales count samples by gain / (1 << fade_gain_shift), where gain <= 1.0
+static void scale_samples( Music_Emu::sample_t* io, long count, int gain )
+{
+	#if BLARGG_SIMD_SSE2
+		// products are 30 bits, so split them into 16-bit halves and rejoin
+		__m128i const g = _mm_set1_epi16( (short) gain );
+		for ( ; count >= 8; count -= 8, io += 8 )
+		{
+			__m128i const s = _mm_loadu_si128( (__m128i const*) io );
+			__m128i const lo = _mm_mullo_epi16( s, g );
+			__m128i const hi = _mm_mulhi_epi16( s, g );
+			__m128i const a = _mm_srai_epi32( _mm_unpacklo_epi16( lo, hi ), fade_gain_shift );
+			__m128i const b = _mm_srai_epi32( _mm_unpackhi_epi16( lo, hi ), fade_gain_shift );
+			_mm_storeu_si128( (__m128i*) io, _mm_packs_epi32( a, b ) );
+		}
+	#endif
+
+	for ( ; count; --count )
+	{
+		*io = Music_Emu::sample_t ((*io * gain) >> fade_gain_shift);
+		++io;
+	}
+}
+
 void Music_Emu::handle_fade( long out_count, sample_t* out )
 {
 	for ( int i = 0; i < out_count; i += fade_block_size )
 	{
-		int const shift = 14;
-		int const unit = 1 << shift;
-		int gain = int_log( (out_time + i - fade_start) / fade_block_size,
-				fade_step, unit );
+		int const unit = 1 << fade_gain_shift;
+		int32_t const block = (int32_t) ((out_time + i - fade_start) / fade_block_size);
+		int gain = (block < fade_gain_count) ? fade_gains [block] :
+				int_log( block, fade_step, unit );
 		if ( gain < (unit >> fade_shift) )
-			track_ended_ = emu_track_ended_ = true;
-
-		sample_t* io = &out [i];
-		for ( int count = min( fade_block_size, out_count - i ); count; --count )
 		{
-			*io = sample_t ((*io * gain) >> shift);
-			++io;
+			track_ended_ = emu_track_ended_ = true;
+			if ( track_end_time < 0 )
+				track_end_time = out_time + min( i + fade_block_size, out_count );
 		}
+
+		scale_samples( &out [i], min( fade_block_size, out_count - i ), gain );
 	}
 }
 
@@ -403,7 +631,11 @@ void Music_Emu::emu_play( long count, sample_t* out )
 	check( current_track_ >= 0 );
 	emu_time += count;
 	if ( current_track_ >= 0 && !emu_track_ended_ )
+	{
+		Emu_Stats_Timer timer( stats_, stats_.counts.emulate_nsec );
+		stats_.counts.samples_emulated += count;
 		end_track_if_error( play_( count, out ) );
+	}
 	else
 		blarg_memset( out, 0, count * sizeof *out );
 }
@@ -411,9 +643,28 @@ void Music_Emu::emu_play( long count, sample_t* out )
 // number of consecutive silent samples at end
 static long count_silence( Music_Emu::sample_t* begin, long size )
 {
+	Music_Emu::sample_t* p = begin + size;
+
+	// skip 16 silent samples at a time, leaving the block with the last
+	// non-silent sample for the scalar loop, and at least the sentinel
+	#if BLARGG_SIMD_SSE2
+		__m128i const hi = _mm_set1_epi16( silence_threshold / 2 );
+		__m128i const lo = _mm_set1_epi16( -(silence_threshold / 2) );
+		while ( p - begin > 16 )
+		{
+			__m128i const a = _mm_loadu_si128( (__m128i const*) (p - 16) );
+			__m128i const b = _mm_loadu_si128( (__m128i const*) (p - 8) );
+			__m128i const loud = _mm_or_si128(
+					_mm_or_si128( _mm_cmpgt_epi16( a, hi ), _mm_cmplt_epi16( a, lo ) ),
+					_mm_or_si128( _mm_cmpgt_epi16( b, hi ), _mm_cmplt_epi16( b, lo ) ) );
+			if ( _mm_movemask_epi8( loud ) )
+				break;
+			p -= 16;
+		}
+	#endif
+
 	Music_Emu::sample_t first = *begin;
 	*begin = silence_threshold; // sentinel
-	Music_Emu::sample_t* p = begin + size;
 	while ( (unsigned) (*--p + silence_threshold / 2) <= (unsigned) silence_threshold ) { }
 	*begin = first;
 	return (long)(size - (p - begin));
@@ -425,6 +676,8 @@ void Music_Emu::fill_buf()
 	assert( !buf_remain );
 	if ( !emu_track_ended_ )
 	{
+		Emu_Stats_Timer timer( stats_, stats_.counts.lookahead_nsec );
+		stats_.counts.lookahead_samples += buf_size;
 		emu_play( buf_size, buf.begin() );
 		long silence = count_silence( buf.begin(), buf_size );
 		if ( silence < buf_size )
@@ -439,6 +692,9 @@ void Music_Emu::fill_buf()
 
 blargg_err_t Music_Emu::play( long out_count, sample_t* out )
 {
+	Emu_Stats_Timer timer( stats_, stats_.counts.play_nsec );
+	stats_.counts.samples_played += out_count;
+	apply_controls();
 	if ( track_ended_ )
 	{
 		blarg_memset( out, 0, out_count * sizeof *out );
@@ -448,6 +704,9 @@ blargg_err_t Music_Emu::play( long out_count, sample_t* out )
 		require( current_track() >= 0 );
 		require( out_count % out_channels() == 0 );
 
+		if ( silence_pending )
+			skip_initial_silence( initial_silence_limit() );
+
 		assert( emu_time >= out_time );
 
 		// prints nifty graph of how far ahead we are when searching for silence
@@ -457,7 +716,7 @@ blargg_err_t Music_Emu::play( long out_count, sample_t* out )
 		if ( silence_count )
 		{
 			// during a run of silence, run emulator at >=2x speed so it gets ahead
-			long ahead_time = silence_lookahead * (out_time + out_count - silence_time) + silence_time;
+			int64_t ahead_time = silence_lookahead * (out_time + out_count - silence_time) + silence_time;
 			while ( emu_time < ahead_time && !(buf_remain | (long)emu_track_ended_) )
 				fill_buf();
 
@@ -471,6 +730,9 @@ blargg_err_t Music_Emu::play( long out_count, sample_t* out )
 				track_ended_  = emu_track_ended_ = true;
 				silence_count = 0;
 				buf_remain    = 0;
+
+				// track ended where the silence began, likely in an earlier call
+				track_end_time = silence_time + (-silence_time & (out_channels() - 1));
 			}
 		}
 
@@ -488,7 +750,7 @@ blargg_err_t Music_Emu::play( long out_count, sample_t* out )
 		if ( remain )
 		{
 			emu_play( remain, out + pos );
-			track_ended_ |= emu_track_ended_;
+			track_ended_ = track_ended_ || emu_track_ended_;
 
 			if ( !ignore_silence_ || out_time > fade_start )
 			{
@@ -504,9 +766,16 @@ blargg_err_t Music_Emu::play( long out_count, sample_t* out )
 
 		if ( fade_start >= 0 && out_time > fade_start )
 			handle_fade( out_count, out );
+
+		if ( track_ended_ && track_end_time < 0 )
+		{
+			// track ended within this call, at start of its trailing silence
+			long end = out_count - count_silence( out, out_count );
+			track_end_time = out_time + end + (-end & (out_channels() - 1));
+		}
 	}
 	out_time += out_count;
-	out_time_scaled += (int32_t)(out_count * tempo_ / out_channels());
+	out_time_scaled += (int64_t)(out_count * tempo_ / out_channels());
 	return 0;
 }
 
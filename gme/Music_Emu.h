@@ -5,6 +5,8 @@
 #define MUSIC_EMU_H
 
 #include "Gme_File.h"
+#include "Emu_Stats.h"
+#include <atomic>
 class Multi_Buffer;
 
 struct Music_Emu : public Gme_File {
@@ -24,6 +26,20 @@ public:
 	// Start a track, where 0 is the first track. Also clears warning string.
 	blargg_err_t start_track( int );
 
+	// Same as start_track(), except that the search for the end of silence at
+	// the beginning of the track is left to skip_initial_silence(). This can
+	// be called later, for example from another thread. play() and skip()
+	// complete any search still pending.
+	blargg_err_t start_track_deferred( int );
+
+	// Continues initial silence search for at most count samples of emulation.
+	// Does nothing if track_ready().
+	void skip_initial_silence( long count );
+
+	// True unless the initial silence search of start_track_deferred() is
+	// still pending
+	bool track_ready() const;
+
 	// Generate 'count' samples info 'buf'. Output is in stereo. Any emulation
 	// errors set warning string, and major errors also end track.
 	typedef short sample_t;
@@ -34,6 +50,12 @@ public:
 	// Sample rate sound is generated at
 	long sample_rate() const;
 
+	// Sample rate the loaded file's sound chips generate samples at, or 0 if the
+	// emulator synthesizes sound directly at any rate. At this sample rate, sound
+	// isn't resampled internally. Info-only emulators (gme_info_only) report it too,
+	// so it can be found before creating the emulator to play the file.
+	long preferred_sample_rate() const          { return preferred_sample_rate_(); }
+
 	// Index of current track or -1 if one hasn't been started
 	int current_track() const;
 
@@ -76,16 +98,34 @@ public:
 	// Seek to new time in track (scaled with tempo).
 	blargg_err_t seek_scaled( long msec );
 
+	// Same as tell(), tell_samples(), tell_scaled(), seek(), seek_samples() and
+	// seek_scaled(), but with 64-bit times, which can't overflow no matter how long
+	// a track is played
+	int64_t tell64() const;
+	int64_t tell_samples64() const;
+	int64_t tell_scaled64() const;
+	blargg_err_t seek64( int64_t msec );
+	blargg_err_t seek_samples64( int64_t n );
+	blargg_err_t seek_scaled64( int64_t msec );
+
 	// Skip n samples
 	blargg_err_t skip( long n );
 
 	// True if a track has reached its end
 	bool track_ended() const;
 
+	// Number of samples generated from beginning of track up to where it ended,
+	// not counting trailing silence, or -1 if track hasn't ended
+	int64_t track_end_samples() const;
+
 	// Set start time and length of track fade out. Once fade ends track_ended() returns
 	// true. Fade time can be changed while track is playing.
 	void set_fade( long start_msec, long length_msec = 8000 );
 
+	// Number of samples from beginning of track to start of fade, or a value larger
+	// than any track if no fade is set
+	int64_t fade_start_samples() const;
+
 	// Controls whether or not to automatically load and obey track length
 	// metadata for supported emulators.
 	//
@@ -130,6 +170,12 @@ public:
 	// equalizer settings.
 	void enable_accuracy( bool enable = true );
 
+	// Set quality tier, gme_quality_draft, gme_quality_normal (default) or
+	// gme_quality_high. Emulators read it when a file is loaded, so changing it
+	// afterwards is an error.
+	blargg_err_t set_quality( int );
+	int quality() const { return quality_; }
+
 // Sound equalization (treble/bass)
 
 	// Frequency equalizer parameters (see gme.txt)
@@ -153,6 +199,29 @@ public:
 	// Equalizer settings for TV speaker
 	static equalizer_t const tv_eq;
 
+// Thread-safe control
+
+	// Same as mute_voices(), set_tempo(), set_equalizer(), disable_echo() and
+	// set_fade(), except that these can be called from any thread, even while
+	// another is in play(). Changes are queued without blocking and applied in
+	// order at the beginning of the next play() or skip(). Returns an error if
+	// too many changes are already waiting.
+	blargg_err_t post_mute_voices( int mask );
+	blargg_err_t post_tempo( double );
+	blargg_err_t post_equalizer( equalizer_t const& );
+	blargg_err_t post_disable_echo( bool disable );
+	blargg_err_t post_fade( long start_msec, long length_msec = 8000 );
+
+// Performance statistics
+
+	// Counters for current track (see gme_stats_t in gme.h). Must not be called
+	// while another thread is in play().
+	typedef gme_stats_t stats_t;
+	void get_stats( stats_t* out ) const;
+
+	// Enables measuring of time spent in each stage of play()
+	void enable_stats_timing( bool enable = true ) { stats_.timed = enable; }
+
 public:
 	Music_Emu();
 	~Music_Emu();
@@ -169,6 +238,10 @@ protected:
 	double gain() const                         { return gain_; }
 	double tempo() const                        { return tempo_; }
 	void remute_voices();
+
+	// Counters for derived emulators to add to
+	Emu_Stats& emu_stats()                      { return stats_; }
+	void count_apu_write()                      { stats_.counts.apu_writes++; }
 	blargg_err_t set_multi_channel_( bool is_enabled );
 
 	virtual blargg_err_t set_sample_rate_( long sample_rate ) = 0;
@@ -177,6 +250,8 @@ protected:
 	virtual void mute_voices_( int mask ) = 0;
 	virtual void disable_echo_( bool /* disable */);
 	virtual void set_tempo_( double ) = 0;
+	virtual int64_t idle_clocks_() const        { return 0; } // CPU clocks skipped in idle loops
+	virtual long preferred_sample_rate_() const { return 0; }
 	virtual blargg_err_t start_track_( int ) = 0; // tempo is set before this
 	virtual blargg_err_t play_( long count, sample_t* out ) = 0;
 	virtual blargg_err_t skip_( long count );
@@ -198,40 +273,65 @@ private:
 	int mute_mask_;
 	double tempo_;
 	double gain_;
+	int quality_;
 	bool multi_channel_;
 
 	// returns the number of output channels, i.e. usually 2 for stereo, unlesss multi_channel_ == true
 	int out_channels() const { return this->multi_channel() ? 2*8 : 2; }
 
 	long sample_rate_;
-	int32_t msec_to_samples( int32_t msec ) const;
+	int64_t msec_to_samples( int64_t msec ) const;
 
 	// track-specific
 	int current_track_;
-	int32_t out_time;        // number of samples played since start of track
-	int32_t out_time_scaled; // number of samples played since start of track (scaled with tempo)
-	int32_t emu_time;        // number of samples emulator has generated since start of track
+	int64_t out_time;        // number of samples played since start of track
+	int64_t out_time_scaled; // number of samples played since start of track (scaled with tempo)
+	int64_t emu_time;        // number of samples emulator has generated since start of track
 	bool emu_track_ended_;   // emulator has reached end of track
 	bool emu_autoload_playback_limit_; // whether to load and obey track length by default
-	volatile bool track_ended_;
+	std::atomic<bool> track_ended_;
 	void clear_track_vars();
 	void end_track_if_error( blargg_err_t );
 
 	// fading
-	int32_t fade_start;
+	int64_t fade_start;
 	int fade_step;
+	blargg_vector<short> fade_gains; // gain of each fade block, from set_fade()
+	long fade_gain_count;
+	int64_t track_end_time;  // out_time where track ended, or -1
 	void handle_fade( long count, sample_t* out );
 
 	// silence detection
 	int silence_lookahead; // speed to run emulator when looking ahead for silence
 	bool ignore_silence_;
-	long silence_time;     // number of samples where most recent silence began
+	int64_t silence_time;  // number of samples where most recent silence began
 	long silence_count;    // number of samples of silence to play before using buf
 	long buf_remain;       // number of samples left in silence buffer
 	enum { buf_size = 2048 };
 	blargg_vector<sample_t> buf;
+	bool silence_pending;  // start_track_deferred() search not finished
 	void fill_buf();
 	void emu_play( long count, sample_t* out );
+	long initial_silence_limit() const { return max_initial_silence * out_channels() * sample_rate(); }
+
+	Emu_Stats stats_;
+
+	// control queue, a bounded multi-producer queue where each slot's sequence
+	// number tells whether it's free or filled for the current lap
+	struct control_t {
+		int type;
+		int mask;
+		double tempo;
+		long start, length;
+		equalizer_t eq;
+	};
+	enum { control_count = 32 }; // power of 2
+	control_t controls [control_count];
+	std::atomic<unsigned> control_seqs [control_count];
+	std::atomic<unsigned> control_head; // next slot to fill
+	unsigned control_tail;              // next slot to apply; used only by play()
+	blargg_err_t post_control( control_t const& );
+	void apply_controls();
 
 	Multi_Buffer* effects_buffer;
 	friend Music_Emu* gme_internal_new_emu_( gme_type_t, int, bool );
@@ -263,6 +363,9 @@ inline int Music_Emu::voice_count() const           { return voice_count_; }
 inline const int** Music_Emu::voice_volumes() const { return voice_volumes_; }
 inline int Music_Emu::current_track() const         { return current_track_; }
 inline bool Music_Emu::track_ended() const          { return track_ended_; }
+inline bool Music_Emu::track_ready() const          { return !silence_pending; }
+inline int64_t Music_Emu::track_end_samples() const { return track_end_time; }
+inline int64_t Music_Emu::fade_start_samples() const{ return fade_start; }
 inline const Music_Emu::equalizer_t& Music_Emu::equalizer() const { return equalizer_; }
 
 inline void Music_Emu::enable_accuracy( bool b )    { enable_accuracy_( b ); }
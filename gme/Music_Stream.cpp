@@ -0,0 +1,339 @@
+// Game_Music_Emu https://bitbucket.org/mpyne/game-music-emu/
+
+#include "Music_Stream.h"
+
+#include <string.h>
+#include <chrono>
+#if defined (_WIN32)
+	#include <windows.h>
+	#include <process.h>
+#endif
+
+/* This module is free software; you can redistribute it and/or modify it
+under the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. This module is distributed in the hope that it will
+be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General
+Public License for more details. You should have received a copy of the GNU
+Lesser General Public License along with this module; if not, write to the Free
+Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+02110-1301 USA */
+
+#include "blargg_source.h"
+
+long const min_buffer_size = 1024;
+long const max_chunk_size = 4096; // keeps each emulation step short
+
+Music_Stream::Music_Stream()
+{
+	emu_ = 0;
+	next_ = 0;
+	next_track = 0;
+	crossfade = false;
+	size_ = 0;
+	chunk_size = 0;
+	poll_msec = 1;
+	write_pos = 0;
+	read_pos = 0;
+	emu_ended = true;
+	stopping = false;
+	error_ = 0;
+	underrun_count_ = 0;
+	underrun_samples_ = 0;
+	worker_running = false;
+}
+
+Music_Stream::~Music_Stream()
+{
+	stop();
+}
+
+blargg_err_t Music_Stream::start( Music_Emu* emu, long buffer_size )
+{
+	stop();
+	require( emu && emu->current_track() >= 0 ); // start_track() must have been called already
+
+	long size = min_buffer_size;
+	while ( size < buffer_size )
+		size *= 2;
+	RETURN_ERR( buf.resize( size ) );
+	size_ = size;
+
+	// a power of 2 and a multiple of the channel count, so chunks never
+	// straddle the end of buf
+	chunk_size = size / 4;
+	if ( chunk_size > max_chunk_size )
+		chunk_size = max_chunk_size;
+	RETURN_ERR( mix_buf.resize( chunk_size ) );
+
+	// a missed wakeup delays rendering by at most a quarter of a chunk
+	long const channels = emu->multi_channel() ? 16 : 2;
+	poll_msec = (int) (chunk_size * 1000 / (emu->sample_rate() * channels) / 4);
+	if ( poll_msec < 1 )
+		poll_msec = 1;
+
+	write_pos = 0;
+	read_pos = 0;
+	emu_ended = emu->track_ended();
+	stopping = false;
+	error_ = 0;
+	underrun_count_ = 0;
+	underrun_samples_ = 0;
+
+	emu_ = emu;
+	next_ = 0;
+#if defined (_WIN32)
+	worker = (void*) _beginthreadex( 0, 0, &render_thread, this, 0, 0 );
+	if ( !worker )
+#else
+	if ( pthread_create( &worker, 0, &render_thread, this ) )
+#endif
+	{
+		emu_ = 0;
+		emu_ended = true;
+		return "Couldn't start stream thread";
+	}
+	worker_running = true;
+	return 0;
+}
+
+blargg_err_t Music_Stream::start_track( Music_Emu* emu, int track, long buffer_size )
+{
+	stop();
+	RETURN_ERR( emu->start_track_deferred( track ) );
+	return start( emu, buffer_size );
+}
+
+blargg_err_t Music_Stream::queue_track( Music_Emu* next, int track, bool fade )
+{
+	Music_Emu* const emu = emu_.load( std::memory_order_acquire );
+	require( emu ); // start() must have been called already
+
+	// the worker only changes emu_ while a track is queued
+	if ( track_queued() )
+		return "A track is already queued";
+
+	if ( next->sample_rate() != emu->sample_rate() ||
+			next->multi_channel() != emu->multi_channel() )
+		return "Queued track must have same sample rate and channel count";
+
+	// current emulator belongs to the worker, so it starts the track later
+	if ( next != emu )
+		RETURN_ERR( next->start_track_deferred( track ) );
+
+	next_track = track;
+	crossfade = fade && next != emu;
+	next_.store( next, std::memory_order_release );
+	wake.notify_one();
+	return 0;
+}
+
+void Music_Stream::stop()
+{
+	if ( worker_running )
+	{
+		stopping.store( true, std::memory_order_release );
+		wake.notify_one();
+	#if defined (_WIN32)
+		WaitForSingleObject( worker, INFINITE );
+		CloseHandle( worker );
+	#else
+		pthread_join( worker, 0 );
+	#endif
+		worker_running = false;
+	}
+	emu_ = 0;
+	next_ = 0;
+	write_pos = 0;
+	read_pos = 0;
+	emu_ended = true;
+}
+
+// Mixes count samples of in into io, clamping to 16 bits
+static void mix_samples( Music_Stream::sample_t* io, Music_Stream::sample_t const* in, long count )
+{
+	for ( long i = 0; i < count; i++ )
+	{
+		int s = io [i] + in [i];
+		if ( (int16_t) s != s )
+			s = 0x7FFF - (s >> 24);
+		io [i] = s;
+	}
+}
+
+blargg_err_t Music_Stream::play_next( Music_Emu* next )
+{
+	blargg_err_t err = 0;
+	if ( next == emu_.load( std::memory_order_relaxed ) )
+		err = next->start_track_deferred( next_track );
+
+	emu_.store( next, std::memory_order_release );
+	next_.store( 0, std::memory_order_release );
+	return err;
+}
+
+#if defined (_WIN32)
+unsigned __stdcall Music_Stream::render_thread( void* self )
+{
+	((Music_Stream*) self)->render();
+	return 0;
+}
+#else
+void* Music_Stream::render_thread( void* self )
+{
+	((Music_Stream*) self)->render();
+	return 0;
+}
+#endif
+
+void Music_Stream::render()
+{
+	sample_t* const out = buf.begin();
+	long const mask = size_ - 1;
+	Music_Emu* emu = emu_.load( std::memory_order_relaxed );
+	long const channels = emu->multi_channel() ? 16 : 2;
+	bool mixing = false; // crossfade to queued track in progress
+
+	while ( !stopping.load( std::memory_order_acquire ) )
+	{
+		Music_Emu* const next = next_.load( std::memory_order_acquire );
+		long const pos = write_pos.load( std::memory_order_relaxed );
+		long const fill = pos - read_pos.load( std::memory_order_acquire );
+		bool const ended = emu_ended.load( std::memory_order_relaxed );
+
+		if ( ended && next )
+		{
+			// track was queued after the current one had ended
+			blargg_err_t err = play_next( next );
+			emu = next;
+			mixing = false;
+			if ( err )
+				error_.store( err, std::memory_order_release );
+			else
+				emu_ended.store( false, std::memory_order_release );
+			continue;
+		}
+
+		if ( next && next != emu && !next->track_ready() && fill >= size_ / 2 )
+		{
+			// pre-roll queued track, while keeping at least half the buffer full
+			next->skip_initial_silence( chunk_size );
+			continue;
+		}
+
+		if ( ended || fill > size_ - chunk_size )
+		{
+			// read() wakes us without taking the lock, so a wakeup can be
+			// missed; the timeout bounds the cost of that
+			std::unique_lock<std::mutex> lock( mutex );
+			wake.wait_for( lock, std::chrono::milliseconds( poll_msec ) );
+			continue;
+		}
+
+		if ( !emu->track_ready() )
+		{
+			// search in small steps so stop() isn't held up
+			emu->skip_initial_silence( chunk_size );
+			if ( !emu->track_ready() )
+				continue;
+		}
+
+		sample_t* const io = out + (pos & mask);
+		int64_t const start = emu->tell_samples64();
+		blargg_err_t err = emu->play( chunk_size, io );
+
+		if ( !err && next && crossfade )
+		{
+			long from = 0;
+			if ( !mixing )
+			{
+				int64_t const fade = emu->fade_start_samples() - start;
+				mixing = (fade < chunk_size);
+				if ( mixing && fade > 0 )
+					from = (long) fade - fade % channels;
+			}
+
+			if ( mixing )
+			{
+				err = next->play( chunk_size - from, mix_buf.begin() );
+				if ( !err )
+					mix_samples( io + from, mix_buf.begin(), chunk_size - from );
+			}
+		}
+
+		if ( !err && next && emu->track_ended() )
+		{
+			// splice queued track in right where this one ended
+			int64_t const ended_at = emu->track_end_samples() - start;
+			long end = 0;
+			if ( ended_at > 0 && !mixing )
+				end = (ended_at < chunk_size) ? (long) ended_at : chunk_size;
+
+			err = play_next( next );
+			emu = next;
+			if ( err )
+				memset( io + end, 0, (chunk_size - end) * sizeof *io );
+			else if ( !mixing && end < chunk_size )
+				err = emu->play( chunk_size - end, io + end );
+			mixing = false;
+		}
+
+		write_pos.store( pos + chunk_size, std::memory_order_release );
+		if ( err )
+			error_.store( err, std::memory_order_release );
+		if ( err || (emu->track_ended() && !next_.load( std::memory_order_acquire )) )
+			emu_ended.store( true, std::memory_order_release );
+	}
+}
+
+long Music_Stream::avail() const
+{
+	return write_pos.load( std::memory_order_acquire ) - read_pos.load( std::memory_order_relaxed );
+}
+
+bool Music_Stream::ready() const
+{
+	return emu_ended.load( std::memory_order_acquire ) || write_pos.load( std::memory_order_acquire );
+}
+
+bool Music_Stream::track_ended() const
+{
+	return emu_ended.load( std::memory_order_acquire ) && !avail();
+}
+
+long Music_Stream::read( long count, sample_t* out )
+{
+	// load ended first, so a true value covers every sample written
+	bool const ended = emu_ended.load( std::memory_order_acquire );
+	long const pos = read_pos.load( std::memory_order_relaxed );
+	long const end = write_pos.load( std::memory_order_acquire );
+	long n = end - pos;
+	if ( n > count )
+		n = count;
+
+	if ( n )
+	{
+		long const offset = pos & (size_ - 1);
+		long first = size_ - offset;
+		if ( first > n )
+			first = n;
+		memcpy( out, buf.begin() + offset, first * sizeof *out );
+		memcpy( out + first, buf.begin(), (n - first) * sizeof *out );
+		read_pos.store( pos + n, std::memory_order_release );
+		wake.notify_one();
+	}
+
+	if ( n < count )
+	{
+		memset( out + n, 0, (count - n) * sizeof *out );
+		// nothing rendered yet is startup latency, not an underrun
+		if ( !ended && end )
+		{
+			underrun_count_.fetch_add( 1, std::memory_order_relaxed );
+			underrun_samples_.fetch_add( count - n, std::memory_order_relaxed );
+		}
+	}
+
+	return n;
+}
@@ -0,0 +1,134 @@
+// Renders a Music_Emu ahead of playback on a worker thread
+
+// Game_Music_Emu https://bitbucket.org/mpyne/game-music-emu/
+#ifndef MUSIC_STREAM_H
+#define MUSIC_STREAM_H
+
+#include "Music_Emu.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#if !defined (_WIN32)
+	#include <pthread.h>
+#endif
+
+// The worker thread fills a single-producer/single-consumer ring buffer, so
+// read() never waits for emulation. Useful when samples are pulled from an
+// audio callback, where a slow frame would otherwise cause an underrun.
+struct Music_Stream {
+public:
+	typedef Music_Emu::sample_t sample_t;
+
+	// Starts rendering current track of emu on a worker thread into a buffer
+	// of at least buffer_size samples. A track must already be started. Emu
+	// must not be used by anything else until stop(), except for its thread-safe
+	// post_*() functions.
+	blargg_err_t start( Music_Emu*, long buffer_size );
+
+	// Starts track on emu and renders it as with start(), returning without
+	// waiting for the search for the end of silence at the beginning of the
+	// track. The search is done by the worker thread, and reads return silence
+	// until ready().
+	blargg_err_t start_track( Music_Emu*, int track, long buffer_size );
+
+	// Queues track of next to play after the current track, starting it as
+	// with start_track(). Its silence search is done ahead of time, and its
+	// first sample directly follows the last non-silent sample of the current
+	// track. If crossfade is true, it instead starts when the current track
+	// starts fading out (see Music_Emu::set_fade()), and the two are mixed for
+	// the length of the fade. next must have the same sample rate and channel
+	// count, and must not be used by anything else until track_queued()
+	// returns false. next may also be the current emulator, in which case the
+	// track is started when the current one ends, without crossfade. Only
+	// one track can be queued at a time.
+	blargg_err_t queue_track( Music_Emu* next, int track, bool crossfade = false );
+
+	// True while a queued track hasn't started. Once false, the previous
+	// emulator is no longer used and emu() is the queued one.
+	bool track_queued() const               { return next_.load( std::memory_order_acquire ) != 0; }
+
+	// Stops worker thread and discards buffered samples and any queued track.
+	// Emulators may be used again afterwards. Does nothing if not started.
+	void stop();
+
+	// Emulator being rendered, or NULL if stopped
+	Music_Emu* emu() const                  { return emu_.load( std::memory_order_acquire ); }
+
+// Consumer use. These never block or allocate.
+
+	// True once the first samples of the track have been rendered, or the
+	// track has ended
+	bool ready() const;
+
+	// Copies up to count samples to out and returns the number copied. The
+	// rest of out is filled with silence, and if ready() and the track hasn't
+	// ended or stopped with an error, the read is counted as an underrun.
+	// count must be a multiple of the emulator's output channel count.
+	long read( long count, sample_t* out );
+
+	// Number of samples ready to be read
+	long avail() const;
+
+	// Buffer size in samples
+	long size() const                       { return size_; }
+
+	// Number of reads that found fewer samples ready than requested
+	long underrun_count() const             { return underrun_count_.load( std::memory_order_relaxed ); }
+
+	// Total number of silent samples substituted by those reads
+	long underrun_samples() const           { return underrun_samples_.load( std::memory_order_relaxed ); }
+
+	// True once the track has ended and all of it has been read
+	bool track_ended() const;
+
+	// Error that stopped rendering, or NULL
+	blargg_err_t error() const              { return error_.load( std::memory_order_acquire ); }
+
+public:
+	Music_Stream();
+	~Music_Stream();
+private:
+	// noncopyable
+	Music_Stream( const Music_Stream& );
+	Music_Stream& operator = ( const Music_Stream& );
+
+	std::atomic<Music_Emu*> emu_;
+	std::atomic<Music_Emu*> next_;
+	int next_track;     // these are set before next_ is published
+	bool crossfade;
+	blargg_vector<sample_t> buf;
+	blargg_vector<sample_t> mix_buf;
+	long size_;         // power of 2
+	long chunk_size;    // samples rendered at a time
+	int poll_msec;      // bounds delay of a missed wakeup
+
+	// Positions only increase; index into buf with & (size_ - 1)
+	std::atomic<long> write_pos;
+	std::atomic<long> read_pos;
+	std::atomic<bool> emu_ended;
+	std::atomic<bool> stopping;
+	std::atomic<blargg_err_t> error_;
+	std::atomic<long> underrun_count_;
+	std::atomic<long> underrun_samples_;
+
+	// std::thread reports failure by throwing, so the worker is created
+	// directly, letting start() return an error
+#if defined (_WIN32)
+	void* worker;       // HANDLE
+#else
+	pthread_t worker;
+#endif
+	bool worker_running;
+	std::mutex mutex;
+	std::condition_variable wake;
+
+	void render();
+#if defined (_WIN32)
+	static unsigned __stdcall render_thread( void* );
+#else
+	static void* render_thread( void* );
+#endif
+	blargg_err_t play_next( Music_Emu* next );
+};
+
+#endif
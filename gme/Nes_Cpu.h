@@ -58,6 +58,9 @@ public:
 	void clear_error_count()            { error_count_ = 0; }
 	unsigned long error_count() const   { return error_count_; }
 
+	// Number of clocks spent in idle loops that were skipped rather than emulated
+	int64_t skipped_clocks() const { return skipped_clocks_; }
+
 	// CPU invokes bad opcode handler if it encounters this
 	enum { bad_opcode = 0xF2 };
 
@@ -77,9 +80,13 @@ private:
 	nes_time_t irq_time_;
 	nes_time_t end_time_;
 	unsigned long error_count_;
+	int64_t skipped_clocks_;
 
 	void set_code_page( int, void const* );
 	inline int update_end_time( nes_time_t end, nes_time_t irq );
+
+	struct policy;
+	template<class P> friend class Cpu_6502;
 };
 
 inline uint8_t const* Nes_Cpu::get_code( nes_addr_t addr )
@@ -0,0 +1,1524 @@
+// 6502 CPU core shared by Nes_Cpu, Sap_Cpu and Hes_Cpu
+
+// Game_Music_Emu https://bitbucket.org/mpyne/game-music-emu/
+
+/* Copyright (C) 2003-2006 Shay Green. This module is free software; you
+can redistribute it and/or modify it under the terms of the GNU Lesser
+General Public License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version. This
+module is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+details. You should have received a copy of the GNU Lesser General Public
+License along with this module; if not, write to the Free Software Foundation,
+Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA */
+
+// Included by a CPU's source file after blargg_source.h. Its run() calls
+// Cpu_6502<P>::run(), where policy P is derived from Cpu_6502_policy and has:
+//
+// cpu_t                            CPU class, which befriends Cpu_6502<P>
+// low_mem( cpu )                   Zero page and stack RAM
+// code( state, low_mem, addr )     Pointer to instruction bytes at addr
+// read( cpu, addr )                Other memory accesses (usually via
+// write( cpu, addr, data )         *_cpu_io.h)
+//
+// and may override the defaults in Cpu_6502_policy.
+//
+// Decimal mode isn't emulated by any CPU; the D flag is only kept for PHP.
+
+#ifndef NES_CPU_RUN_H
+#define NES_CPU_RUN_H
+
+#include "blargg_common.h"
+#include "blargg_endian.h"
+#include "blargg_idle.h"
+
+struct Cpu_6502_policy
+{
+	// Skip undefined opcodes and count them with count_error(), rather than
+	// stopping. run() then returns true only if stopped by HLT before end_time.
+	enum { skip_illegal = 0 };
+
+	// Interrupts clear decimal flag
+	enum { int_clears_d = 0 };
+
+	// BRK at or above this address stops run(). Unused if 0.
+	enum { idle_addr = 0 };
+
+	// HuC6280 opcodes, timing and interrupt vectors. Memory above zero page is
+	// only accessed through read() and write(), MMRs through mmr() and
+	// set_mmr(), and ST0-ST2 go to write_vdp(). $FF at idle_addr waits for the
+	// next interrupt or end_time rather than stopping.
+	enum { huc6280 = 0 };
+
+	// Called at end time; returns offset of interrupt vector to take, or -1
+	template<class Cpu>
+	static int done( Cpu& ) { return -1; }
+
+	// Only called when enabled above
+	template<class Cpu>
+	static void count_error( Cpu& ) { }
+
+	template<class Cpu>
+	static uint8_t const* mmr( Cpu& ) { return 0; }
+
+	template<class Cpu>
+	static void set_mmr( Cpu&, int, int ) { }
+
+	template<class Cpu>
+	static void write_vdp( Cpu&, int, int ) { }
+};
+
+template<class P>
+class Cpu_6502 {
+public:
+	typedef typename P::cpu_t cpu_t;
+
+	// Runs cpu as its run( end_time ) does
+	static bool run( cpu_t&, int32_t end_time );
+
+private:
+	enum { st_n = 0x80 };
+	enum { st_v = 0x40 };
+	enum { st_r = P::huc6280 ? 0 : 0x20 }; // T flag on HuC6280, not emulated
+	enum { st_b = 0x10 };
+	enum { st_d = 0x08 };
+	enum { st_i = 0x04 };
+	enum { st_z = 0x02 };
+	enum { st_c = 0x01 };
+
+	// Interrupt vectors, and offset of BRK's within them
+	enum { vectors = P::huc6280 ? 0xFFF0 : 0xFFFA };
+	enum { brk_vector = P::huc6280 ? 6 : 4 };
+};
+
+#define FLUSH_TIME()    (void) (s.time = s_time)
+#define CACHE_TIME()    (void) (s_time = s.time)
+
+#define TIME                    (s_time + s.base)
+#define READ_LOW( addr )        (low_mem [int (addr)])
+#define WRITE_LOW( addr, data ) (void) (READ_LOW( addr ) = (data))
+#define CODE( addr )            P::code( s, low_mem, (addr) )
+#define READ_PROG( addr )       (*CODE( addr ))
+#define READ( addr )            P::read( cpu, (addr) )
+#define WRITE( addr, data )     {P::write( cpu, (addr), (data) );}
+
+#define SET_SP( v )     (sp = ((v) + 1) | 0x100)
+#define GET_SP()        ((sp - 1) & 0xFF)
+#define PUSH( v )       ((sp = (sp - 1) | 0x100), WRITE_LOW( sp, v ))
+
+// Opcode only defined on HuC6280
+#define HUC6280_ONLY()  if ( !P::huc6280 ) goto unofficial
+
+template<class P>
+bool Cpu_6502<P>::run( cpu_t& cpu, int32_t end_time )
+{
+	cpu.set_end_time( end_time );
+	typename cpu_t::state_t s = cpu.state_;
+	cpu.state = &s;
+	// even on x86, using s.time in place of s_time was slower
+	int32_t s_time = s.time;
+	bool illegal_encountered = false;
+	uint8_t* const low_mem = P::low_mem( cpu );
+	int64_t& skipped_clocks_ = cpu.skipped_clocks_; // for SKIP_IDLE_LOOP
+
+	// registers
+	uint16_t pc = cpu.r.pc;
+	uint8_t a = cpu.r.a;
+	uint8_t x = cpu.r.x;
+	uint8_t y = cpu.r.y;
+	uint16_t sp;
+	SET_SP( cpu.r.sp );
+
+	// status flags
+	#define IS_NEG (nz & 0x8080)
+
+	#define CALC_STATUS( out ) do {\
+		out = status & (st_v | st_d | st_i);\
+		out |= ((nz >> 8) | nz) & st_n;\
+		out |= c >> 8 & st_c;\
+		if ( !(nz & 0xFF) ) out |= st_z;\
+	} while ( 0 )
+
+	#define SET_STATUS( in ) do {\
+		status = in & (st_v | st_d | st_i);\
+		nz = in << 8;\
+		c = nz;\
+		nz |= ~in & st_z;\
+	} while ( 0 )
+
+	uint8_t status;
+	uint16_t c;  // carry set if (c & 0x100) != 0
+	uint16_t nz; // Z set if (nz & 0xFF) == 0, N set if (nz & 0x8080) != 0
+	{
+		uint8_t temp = cpu.r.status;
+		SET_STATUS( temp );
+	}
+
+	static uint8_t const clocks_6502 [256] =
+	{// 0 1 2 3 4 5 6 7 8 9 A B C D E F
+		0,6,2,8,3,3,5,5,3,2,2,2,4,4,6,6,// 0
+		3,5,2,8,4,4,6,6,2,4,2,7,4,4,7,7,// 1
+		6,6,2,8,3,3,5,5,4,2,2,2,4,4,6,6,// 2
+		3,5,2,8,4,4,6,6,2,4,2,7,4,4,7,7,// 3
+		6,6,2,8,3,3,5,5,3,2,2,2,3,4,6,6,// 4
+		3,5,2,8,4,4,6,6,2,4,2,7,4,4,7,7,// 5
+		6,6,2,8,3,3,5,5,4,2,2,2,5,4,6,6,// 6
+		3,5,2,8,4,4,6,6,2,4,2,7,4,4,7,7,// 7
+		2,6,2,6,3,3,3,3,2,2,2,2,4,4,4,4,// 8
+		3,6,2,6,4,4,4,4,2,5,2,5,5,5,5,5,// 9
+		2,6,2,6,3,3,3,3,2,2,2,2,4,4,4,4,// A
+		3,5,2,5,4,4,4,4,2,4,2,4,4,4,4,4,// B
+		2,6,2,8,3,3,5,5,2,2,2,2,4,4,6,6,// C
+		3,5,2,8,4,4,6,6,2,4,2,7,4,4,7,7,// D
+		2,6,2,8,3,3,5,5,2,2,2,2,4,4,6,6,// E
+		3,5,0,8,4,4,6,6,2,4,2,7,4,4,7,7 // F
+	}; // 0x00 was 7 and 0xF2 was 2
+
+	// TODO: each reference lists slightly different timing values, ugh
+	static uint8_t const clocks_huc6280 [256] =
+	{// 0 1 2  3 4 5 6 7 8 9 A B C D E F
+		1,7,3, 4,6,4,6,7,3,2,2,2,7,5,7,6,// 0
+		4,7,7, 4,6,4,6,7,2,5,2,2,7,5,7,6,// 1
+		7,7,3, 4,4,4,6,7,4,2,2,2,5,5,7,6,// 2
+		4,7,7, 2,4,4,6,7,2,5,2,2,5,5,7,6,// 3
+		7,7,3, 4,8,4,6,7,3,2,2,2,4,5,7,6,// 4
+		4,7,7, 5,2,4,6,7,2,5,3,2,2,5,7,6,// 5
+		7,7,2, 2,4,4,6,7,4,2,2,2,7,5,7,6,// 6
+		4,7,7,17,4,4,6,7,2,5,4,2,7,5,7,6,// 7
+		4,7,2, 7,4,4,4,7,2,2,2,2,5,5,5,6,// 8
+		4,7,7, 8,4,4,4,7,2,5,2,2,5,5,5,6,// 9
+		2,7,2, 7,4,4,4,7,2,2,2,2,5,5,5,6,// A
+		4,7,7, 8,4,4,4,7,2,5,2,2,5,5,5,6,// B
+		2,7,2,17,4,4,6,7,2,2,2,2,5,5,7,6,// C
+		4,7,7,17,2,4,6,7,2,5,3,2,2,5,7,6,// D
+		2,7,2,17,4,4,6,7,2,2,2,2,5,5,7,6,// E
+		4,7,7,17,2,4,6,7,2,5,4,2,2,5,7,6 // F
+	}; // 0x00 was 8
+
+	uint8_t const* const clock_table = P::huc6280 ? clocks_huc6280 : clocks_6502;
+
+	goto loop;
+branch_not_taken:
+	s_time -= P::huc6280 ? 2 : 1;
+loop:
+
+	#ifndef NDEBUG
+	{
+		int32_t correct = cpu.end_time_;
+		if ( !(status & st_i) && correct > cpu.irq_time_ )
+			correct = cpu.irq_time_;
+		check( s.base == correct );
+	}
+	#endif
+
+	check( (unsigned) GET_SP() < 0x100 );
+	check( (unsigned) pc < 0x10000 );
+	check( (unsigned) a < 0x100 );
+	check( (unsigned) x < 0x100 );
+	check( (unsigned) y < 0x100 );
+
+	uint8_t const* instr = CODE( pc );
+	uint8_t opcode = *instr++;
+	pc++;
+
+	uint16_t data;
+	data = clock_table [opcode];
+	if ( (s_time += data) >= 0 )
+		goto possibly_out_of_time;
+almost_out_of_time:
+
+	data = *instr;
+
+	#ifdef NES_CPU_LOG_H
+		nes_cpu_log( "cpu_log", pc - 1, opcode, instr [0], instr [1] );
+	#endif
+
+	switch ( opcode )
+	{
+possibly_out_of_time:
+		if ( s_time < (int) data )
+			goto almost_out_of_time;
+		s_time -= data;
+		goto out_of_time;
+
+// Macros
+
+#define GET_MSB()   (instr [1])
+#define ADD_PAGE()  (pc++, data += 0x100 * GET_MSB())
+#define GET_ADDR()  GET_LE16( instr )
+
+#define NO_PAGE_CROSSING( lsb )
+#define HANDLE_PAGE_CROSSING( lsb ) if ( !P::huc6280 ) s_time += (lsb) >> 8;
+
+#define INC_DEC_AXY( reg, n ) reg = uint8_t (nz = reg + n); goto loop;
+
+#define IND_Y( cross, out ) {\
+		uint16_t temp = READ_LOW( data ) + y;\
+		out = temp + 0x100 * READ_LOW( uint8_t (data + 1) );\
+		cross( temp );\
+	}
+
+#define IND_X( out ) {\
+		uint16_t temp = data + x;\
+		out = 0x100 * READ_LOW( uint8_t (temp + 1) ) + READ_LOW( uint8_t (temp) );\
+	}
+
+#define ARITH_ADDR_MODES( op )\
+case op - 0x04: /* (ind,x) */\
+	IND_X( data )\
+	goto ptr##op;\
+case op + 0x0C: /* (ind),y */\
+	IND_Y( HANDLE_PAGE_CROSSING, data )\
+	goto ptr##op;\
+case op + 0x0D: /* (ind) */\
+	HUC6280_ONLY();\
+	data = 0x100 * READ_LOW( uint8_t (data + 1) ) + READ_LOW( data );\
+	goto ptr##op;\
+case op + 0x10: /* zp,X */\
+	data = uint8_t (data + x);/* FALLTHRU */\
+case op + 0x00: /* zp */\
+	data = READ_LOW( data );\
+	goto imm##op;\
+case op + 0x14: /* abs,Y */\
+	data += y;\
+	goto ind##op;\
+case op + 0x18: /* abs,X */\
+	data += x;\
+ind##op:\
+	HANDLE_PAGE_CROSSING( data );/* FALLTHRU */\
+case op + 0x08: /* abs */\
+	ADD_PAGE();\
+ptr##op:\
+	FLUSH_TIME();\
+	data = READ( data );\
+	CACHE_TIME();/*FALLTHRU*/\
+case op + 0x04: /* imm */\
+imm##op:
+
+// TODO: more efficient way to handle negative branch that wraps PC around
+#define BRANCH( cond )\
+{\
+	int16_t offset = (int8_t) data;\
+	uint16_t extra_clock = (++pc & 0xFF) + offset;\
+	if ( !(cond) ) goto branch_not_taken;\
+	pc = uint16_t (pc + offset);\
+	if ( !P::huc6280 )\
+		s_time += extra_clock >> 8 & 1;\
+	goto loop;\
+}
+
+// Branch to itself, or one that polls zero page with the instruction just
+// before it
+#define IDLE_BRANCH( cond )\
+{\
+	int16_t offset = (int8_t) data;\
+	uint16_t extra_clock = (++pc & 0xFF) + offset;\
+	if ( !(cond) ) goto branch_not_taken;\
+	pc = uint16_t (pc + offset);\
+	int extra = P::huc6280 ? 0 : extra_clock >> 8 & 1;\
+	s_time += extra;\
+	if ( offset == -2 )\
+		SKIP_IDLE_LOOP( clock_table [opcode] + extra )\
+	else if ( offset == -4 && is_zp_read( READ_PROG( pc ) ) )\
+		SKIP_IDLE_LOOP( clock_table [READ_PROG( pc )] + clock_table [opcode] + extra )\
+	goto loop;\
+}
+
+// Often-Used
+
+	case 0xB5: // LDA zp,x
+		a = nz = READ_LOW( uint8_t (data + x) );
+		pc++;
+		goto loop;
+
+	case 0xA5: // LDA zp
+		a = nz = READ_LOW( data );
+		pc++;
+		goto loop;
+
+	case 0xD0: // BNE
+		IDLE_BRANCH( (uint8_t) nz );
+
+	case 0x20: { // JSR
+		uint16_t temp = pc + 1;
+		pc = GET_ADDR();
+		WRITE_LOW( 0x100 | (sp - 1), temp >> 8 );
+		sp = (sp - 2) | 0x100;
+		WRITE_LOW( sp, temp );
+		goto loop;
+	}
+
+	case 0x4C: // JMP abs
+		data = pc - 1;
+		pc = GET_ADDR();
+		if ( pc == data ) // to itself
+			SKIP_IDLE_LOOP( clock_table [opcode] );
+		goto loop;
+
+	case 0xE8: // INX
+		INC_DEC_AXY( x, 1 )
+
+	case 0x10: // BPL
+		IDLE_BRANCH( !IS_NEG )
+
+	ARITH_ADDR_MODES( 0xC5 ) // CMP
+		nz = a - data;
+		pc++;
+		c = ~nz;
+		nz &= 0xFF;
+		goto loop;
+
+	case 0x30: // BMI
+		IDLE_BRANCH( IS_NEG )
+
+	case 0xF0: // BEQ
+		IDLE_BRANCH( !(uint8_t) nz );
+
+	case 0x95: // STA zp,x
+		data = uint8_t (data + x);/*FALLTHRU*/
+	case 0x85: // STA zp
+		pc++;
+		WRITE_LOW( data, a );
+		goto loop;
+
+	case 0xC8: // INY
+		INC_DEC_AXY( y, 1 )
+
+	case 0xA8: // TAY
+		y  = a;
+		nz = a;
+		goto loop;
+
+	case 0x98: // TYA
+		a  = y;
+		nz = y;
+		goto loop;
+
+	case 0xAD:{// LDA abs
+		unsigned addr = GET_ADDR();
+		pc += 2;
+		FLUSH_TIME();
+		a = nz = READ( addr );
+		CACHE_TIME();
+		goto loop;
+	}
+
+	case 0x60: // RTS
+		pc = 1 + READ_LOW( sp );
+		pc += 0x100 * READ_LOW( 0x100 | (sp - 0xFF) );
+		sp = (sp - 0xFE) | 0x100;
+		goto loop;
+
+	// 6502 stores to low RAM directly; HuC6280 maps all memory through MMRs
+	{
+		uint16_t addr;
+
+	case 0x99: // STA abs,Y
+		addr = y + GET_ADDR();
+		pc += 2;
+		if ( !P::huc6280 && addr <= 0x7FF )
+		{
+			WRITE_LOW( addr, a );
+			goto loop;
+		}
+		goto sta_ptr;
+
+	case 0x8D: // STA abs
+		addr = GET_ADDR();
+		pc += 2;
+		if ( !P::huc6280 && addr <= 0x7FF )
+		{
+			WRITE_LOW( addr, a );
+			goto loop;
+		}
+		goto sta_ptr;
+
+	case 0x9D: // STA abs,X (slightly more common than STA abs)
+		addr = x + GET_ADDR();
+		pc += 2;
+		if ( !P::huc6280 && addr <= 0x7FF )
+		{
+			WRITE_LOW( addr, a );
+			goto loop;
+		}
+	sta_ptr:
+		FLUSH_TIME();
+		WRITE( addr, a );
+		CACHE_TIME();
+		goto loop;
+
+	case 0x91: // STA (ind),Y
+		IND_Y( NO_PAGE_CROSSING, addr )
+		pc++;
+		goto sta_ptr;
+
+	case 0x81: // STA (ind,X)
+		IND_X( addr )
+		pc++;
+		goto sta_ptr;
+
+	case 0x92: // STA (ind)
+		HUC6280_ONLY();
+		addr = 0x100 * READ_LOW( uint8_t (data + 1) ) + READ_LOW( data );
+		pc++;
+		goto sta_ptr;
+
+	}
+
+	case 0xA9: // LDA #imm
+		pc++;
+		a  = data;
+		nz = data;
+		goto loop;
+
+	// common read instructions; 6502 reads low RAM mirrors and ROM through
+	// code map
+	{
+		uint16_t addr;
+
+	case 0xA1: // LDA (ind,X)
+		IND_X( addr )
+		pc++;
+		goto a_nz_read_addr;
+
+	case 0xB2: // LDA (ind)
+		HUC6280_ONLY();
+		addr = 0x100 * READ_LOW( uint8_t (data + 1) ) + READ_LOW( data );
+		pc++;
+		goto a_nz_read_addr;
+
+	case 0xB1:// LDA (ind),Y
+		addr = READ_LOW( data ) + y;
+		HANDLE_PAGE_CROSSING( addr );
+		addr += 0x100 * READ_LOW( (uint8_t) (data + 1) );
+		pc++;
+		goto a_nz_read_prog;
+
+	case 0xB9: // LDA abs,Y
+		HANDLE_PAGE_CROSSING( data + y );
+		addr = GET_ADDR() + y;
+		pc += 2;
+		goto a_nz_read_prog;
+
+	case 0xBD: // LDA abs,X
+		HANDLE_PAGE_CROSSING( data + x );
+		addr = GET_ADDR() + x;
+		pc += 2;
+	a_nz_read_prog:
+		if ( !P::huc6280 )
+		{
+			a = nz = READ_PROG( addr );
+			if ( (addr ^ 0x8000) <= 0x9FFF )
+				goto loop;
+		}
+	a_nz_read_addr:
+		FLUSH_TIME();
+		a = nz = READ( addr );
+		CACHE_TIME();
+		goto loop;
+
+	}
+
+// Branch
+
+	case 0x50: // BVC
+		BRANCH( !(status & st_v) )
+
+	case 0x70: // BVS
+		BRANCH( status & st_v )
+
+	case 0xB0: // BCS
+		BRANCH( c & 0x100 )
+
+	case 0x90: // BCC
+		BRANCH( !(c & 0x100) )
+
+	case 0x80: // BRA
+		HUC6280_ONLY();
+		IDLE_BRANCH( true );
+
+	case 0xFF:
+		if ( P::huc6280 && pc == P::idle_addr + 1 )
+			goto idle_done;
+		/* FALLTHRU */
+	case 0x0F: // BBRn
+	case 0x1F:
+	case 0x2F:
+	case 0x3F:
+	case 0x4F:
+	case 0x5F:
+	case 0x6F:
+	case 0x7F:
+	case 0x8F: // BBSn
+	case 0x9F:
+	case 0xAF:
+	case 0xBF:
+	case 0xCF:
+	case 0xDF:
+	case 0xEF: {
+		HUC6280_ONLY();
+		uint16_t t = 0x101 * READ_LOW( data );
+		t ^= 0xFF;
+		pc++;
+		data = GET_MSB();
+		BRANCH( t & (1 << (opcode >> 4)) )
+	}
+
+// Load/store
+
+	case 0x94: // STY zp,x
+		data = uint8_t (data + x); // FALLTHRU
+	case 0x84: // STY zp
+		pc++;
+		WRITE_LOW( data, y );
+		goto loop;
+
+	case 0x96: // STX zp,y
+		data = uint8_t (data + y); // FALLTHRU
+	case 0x86: // STX zp
+		pc++;
+		WRITE_LOW( data, x );
+		goto loop;
+
+	case 0x74: // STZ zp,x
+		HUC6280_ONLY();
+		data = uint8_t (data + x); // FALLTHRU
+	case 0x64: // STZ zp
+		HUC6280_ONLY();
+		pc++;
+		WRITE_LOW( data, 0 );
+		goto loop;
+
+	case 0xB6: // LDX zp,y
+		data = uint8_t (data + y); // FALLTHRU
+	case 0xA6: // LDX zp
+		data = READ_LOW( data ); // FALLTHRU
+	case 0xA2: // LDX #imm
+		pc++;
+		x = data;
+		nz = data;
+		goto loop;
+
+	case 0xB4: // LDY zp,x
+		data = uint8_t (data + x); // FALLTHRU
+	case 0xA4: // LDY zp
+		data = READ_LOW( data ); // FALLTHRU
+	case 0xA0: // LDY #imm
+		pc++;
+		y = data;
+		nz = data;
+		goto loop;
+
+	case 0xBC: // LDY abs,X
+		data += x;
+		HANDLE_PAGE_CROSSING( data );/*FALLTHRU*/
+	case 0xAC:{// LDY abs
+		unsigned addr = data + 0x100 * GET_MSB();
+		pc += 2;
+		FLUSH_TIME();
+		y = nz = READ( addr );
+		CACHE_TIME();
+		goto loop;
+	}
+
+	case 0xBE: // LDX abs,y
+		data += y;
+		HANDLE_PAGE_CROSSING( data );/*FALLTHRU*/
+	case 0xAE:{// LDX abs
+		unsigned addr = data + 0x100 * GET_MSB();
+		pc += 2;
+		FLUSH_TIME();
+		x = nz = READ( addr );
+		CACHE_TIME();
+		goto loop;
+	}
+
+	{
+		uint8_t temp;
+	case 0x8C: // STY abs
+		temp = y;
+		goto store_abs;
+
+	case 0x8E: // STX abs
+		temp = x;
+	store_abs:
+		unsigned addr = GET_ADDR();
+		pc += 2;
+		if ( !P::huc6280 && addr <= 0x7FF )
+		{
+			WRITE_LOW( addr, temp );
+			goto loop;
+		}
+		FLUSH_TIME();
+		WRITE( addr, temp );
+		CACHE_TIME();
+		goto loop;
+	}
+
+	case 0x9E: // STZ abs,x
+		HUC6280_ONLY();
+		data += x; // FALLTHRU
+	case 0x9C: // STZ abs
+		HUC6280_ONLY();
+		ADD_PAGE();
+		pc++;
+		FLUSH_TIME();
+		WRITE( data, 0 );
+		CACHE_TIME();
+		goto loop;
+
+// Compare
+
+	case 0xEC:{// CPX abs
+		unsigned addr = GET_ADDR();
+		pc++;
+		FLUSH_TIME();
+		data = READ( addr );
+		CACHE_TIME();
+		goto cpx_data;
+	}
+
+	case 0xE4: // CPX zp
+		data = READ_LOW( data );/*FALLTHRU*/
+	case 0xE0: // CPX #imm
+	cpx_data:
+		nz = x - data;
+		pc++;
+		c = ~nz;
+		nz &= 0xFF;
+		goto loop;
+
+	case 0xCC:{// CPY abs
+		unsigned addr = GET_ADDR();
+		pc++;
+		FLUSH_TIME();
+		data = READ( addr );
+		CACHE_TIME();
+		goto cpy_data;
+	}
+
+	case 0xC4: // CPY zp
+		data = READ_LOW( data );/*FALLTHRU*/
+	case 0xC0: // CPY #imm
+	cpy_data:
+		nz = y - data;
+		pc++;
+		c = ~nz;
+		nz &= 0xFF;
+		goto loop;
+
+// Logical
+
+	ARITH_ADDR_MODES( 0x25 ) // AND
+		nz = (a &= data);
+		pc++;
+		goto loop;
+
+	ARITH_ADDR_MODES( 0x45 ) // EOR
+		nz = (a ^= data);
+		pc++;
+		goto loop;
+
+	ARITH_ADDR_MODES( 0x05 ) // ORA
+		nz = (a |= data);
+		pc++;
+		goto loop;
+
+// Bit operations
+
+	case 0x3C: // BIT abs,X
+		HUC6280_ONLY();
+		data += x;/*FALLTHRU*/
+	case 0x2C:{// BIT abs
+		unsigned addr = data + 0x100 * GET_MSB();
+		pc++;
+		FLUSH_TIME();
+		nz = READ( addr );
+		CACHE_TIME();
+		goto bit_common;
+	}
+
+	case 0x34: // BIT zp,X
+		HUC6280_ONLY();
+		data = uint8_t (data + x);/*FALLTHRU*/
+	case 0x24: // BIT zp
+		nz = READ_LOW( data );
+		goto bit_common;
+
+	case 0x89: // BIT #imm
+		HUC6280_ONLY();
+		nz = data;
+	bit_common:
+		pc++;
+		status &= ~st_v;
+		status |= nz & st_v;
+		if ( a & nz )
+			goto loop;
+		nz <<= 8; // result must be zero, even if N bit is set
+		goto loop;
+
+	{
+		unsigned addr;
+
+	case 0xB3: // TST abs,x
+		HUC6280_ONLY();
+		addr = GET_MSB() + x;
+		goto tst_abs;
+
+	case 0x93: // TST abs
+		HUC6280_ONLY();
+		addr = GET_MSB();
+	tst_abs:
+		addr += 0x100 * instr [2];
+		pc++;
+		FLUSH_TIME();
+		nz = READ( addr );
+		CACHE_TIME();
+		goto tst_common;
+	}
+
+	case 0xA3: // TST zp,x
+		HUC6280_ONLY();
+		nz = READ_LOW( uint8_t (GET_MSB() + x) );
+		goto tst_common;
+
+	case 0x83: // TST zp
+		HUC6280_ONLY();
+		nz = READ_LOW( GET_MSB() );
+	tst_common:
+		pc += 2;
+		status &= ~st_v;
+		status |= nz & st_v;
+		if ( nz & data )
+			goto loop; // Z should be clear, and nz must be non-zero if nz & data is
+		nz <<= 8; // set Z flag without affecting N flag
+		goto loop;
+
+	{
+		unsigned addr;
+	case 0x0C: // TSB abs
+	case 0x1C: // TRB abs
+		HUC6280_ONLY();
+		addr = GET_ADDR();
+		pc++;
+		goto txb_addr;
+
+	// TODO: everyone lists different behaviors for the status flags, ugh
+	case 0x04: // TSB zp
+	case 0x14: // TRB zp
+		HUC6280_ONLY();
+		addr = data + 0x2000; // zero page is at logical $2000 on HuC6280
+	txb_addr:
+		FLUSH_TIME();
+		nz = a | READ( addr );
+		if ( opcode & 0x10 )
+			nz ^= a; // bits from a will already be set, so this clears them
+		status &= ~st_v;
+		status |= nz & st_v;
+		pc++;
+		WRITE( addr, nz );
+		CACHE_TIME();
+		goto loop;
+	}
+
+	case 0x07: // RMBn
+	case 0x17:
+	case 0x27:
+	case 0x37:
+	case 0x47:
+	case 0x57:
+	case 0x67:
+	case 0x77:
+		HUC6280_ONLY();
+		pc++;
+		READ_LOW( data ) &= ~(1 << (opcode >> 4));
+		goto loop;
+
+	case 0x87: // SMBn
+	case 0x97:
+	case 0xA7:
+	case 0xB7:
+	case 0xC7:
+	case 0xD7:
+	case 0xE7:
+	case 0xF7:
+		HUC6280_ONLY();
+		pc++;
+		READ_LOW( data ) |= 1 << ((opcode >> 4) - 8);
+		goto loop;
+
+// Add/subtract
+
+	ARITH_ADDR_MODES( 0xE5 ) // SBC
+		data ^= 0xFF;
+		goto adc_imm;
+
+	ARITH_ADDR_MODES( 0x65 ) // ADC
+	adc_imm: {
+		int16_t carry = c >> 8 & 1;
+		int16_t ov = (a ^ 0x80) + carry + (int8_t) data; // sign-extend
+		status &= ~st_v;
+		status |= ov >> 2 & 0x40;
+		c = nz = a + data + carry;
+		pc++;
+		a = (uint8_t) nz;
+		goto loop;
+	}
+
+// Shift/rotate
+
+	case 0x4A: // LSR A
+		c = 0;/*FALLTHRU*/
+	case 0x6A: // ROR A
+		nz = c >> 1 & 0x80;
+		c = a << 8;
+		nz |= a >> 1;
+		a = nz;
+		goto loop;
+
+	case 0x0A: // ASL A
+		nz = a << 1;
+		c = nz;
+		a = (uint8_t) nz;
+		goto loop;
+
+	case 0x2A: { // ROL A
+		nz = a << 1;
+		int16_t temp = c >> 8 & 1;
+		c = nz;
+		nz |= temp;
+		a = (uint8_t) nz;
+		goto loop;
+	}
+
+	case 0x5E: // LSR abs,X
+		data += x;/*FALLTHRU*/
+	case 0x4E: // LSR abs
+		c = 0;/*FALLTHRU*/
+	case 0x6E: // ROR abs
+	ror_abs: {
+		ADD_PAGE();
+		FLUSH_TIME();
+		int temp = READ( data );
+		nz = (c >> 1 & 0x80) | (temp >> 1);
+		c = temp << 8;
+		goto rotate_common;
+	}
+
+	case 0x3E: // ROL abs,X
+		data += x;
+		goto rol_abs;
+
+	case 0x1E: // ASL abs,X
+		data += x;/*FALLTHRU*/
+	case 0x0E: // ASL abs
+		c = 0;/*FALLTHRU*/
+	case 0x2E: // ROL abs
+	rol_abs:
+		ADD_PAGE();
+		nz = c >> 8 & 1;
+		FLUSH_TIME();
+		nz |= (c = READ( data ) << 1);
+	rotate_common:
+		pc++;
+		WRITE( data, (uint8_t) nz );
+		CACHE_TIME();
+		goto loop;
+
+	case 0x7E: // ROR abs,X
+		data += x;
+		goto ror_abs;
+
+	case 0x76: // ROR zp,x
+		data = uint8_t (data + x);
+		goto ror_zp;
+
+	case 0x56: // LSR zp,x
+		data = uint8_t (data + x);/*FALLTHRU*/
+	case 0x46: // LSR zp
+		c = 0;/*FALLTHRU*/
+	case 0x66: // ROR zp
+	ror_zp: {
+		int temp = READ_LOW( data );
+		nz = (c >> 1 & 0x80) | (temp >> 1);
+		c = temp << 8;
+		goto write_nz_zp;
+	}
+
+	case 0x36: // ROL zp,x
+		data = uint8_t (data + x);
+		goto rol_zp;
+
+	case 0x16: // ASL zp,x
+		data = uint8_t (data + x);/*FALLTHRU*/
+	case 0x06: // ASL zp
+		c = 0;/*FALLTHRU*/
+	case 0x26: // ROL zp
+	rol_zp:
+		nz = c >> 8 & 1;
+		nz |= (c = READ_LOW( data ) << 1);
+		goto write_nz_zp;
+
+// Increment/decrement
+
+	case 0xCA: // DEX
+		INC_DEC_AXY( x, -1 )
+
+	case 0x88: // DEY
+		INC_DEC_AXY( y, -1 )
+
+	case 0x1A: // INA
+		HUC6280_ONLY();
+		INC_DEC_AXY( a, +1 )
+
+	case 0x3A: // DEA
+		HUC6280_ONLY();
+		INC_DEC_AXY( a, -1 )
+
+	case 0xF6: // INC zp,x
+		data = uint8_t (data + x);/*FALLTHRU*/
+	case 0xE6: // INC zp
+		nz = 1;
+		goto add_nz_zp;
+
+	case 0xD6: // DEC zp,x
+		data = uint8_t (data + x);/*FALLTHRU*/
+	case 0xC6: // DEC zp
+		nz = (uint16_t) -1;
+	add_nz_zp:
+		nz += READ_LOW( data );
+	write_nz_zp:
+		pc++;
+		WRITE_LOW( data, nz );
+		goto loop;
+
+	case 0xFE: // INC abs,x
+		data = x + GET_ADDR();
+		goto inc_ptr;
+
+	case 0xEE: // INC abs
+		data = GET_ADDR();
+	inc_ptr:
+		nz = 1;
+		goto inc_common;
+
+	case 0xDE: // DEC abs,x
+		data = x + GET_ADDR();
+		goto dec_ptr;
+
+	case 0xCE: // DEC abs
+		data = GET_ADDR();
+	dec_ptr:
+		nz = (uint16_t) -1;
+	inc_common:
+		FLUSH_TIME();
+		nz += READ( data );
+		pc += 2;
+		WRITE( data, (uint8_t) nz );
+		CACHE_TIME();
+		goto loop;
+
+// Transfer
+
+	case 0xAA: // TAX
+		x  = a;
+		nz = a;
+		goto loop;
+
+	case 0x8A: // TXA
+		a  = x;
+		nz = x;
+		goto loop;
+
+	case 0x9A: // TXS
+		SET_SP( x ); // verified (no flag change)
+		goto loop;
+
+	case 0xBA: // TSX
+		x = nz = GET_SP();
+		goto loop;
+
+	#define SWAP_REGS( r1, r2 ) {\
+		uint8_t t = r1;\
+		r1 = r2;\
+		r2 = t;\
+		goto loop;\
+	}
+
+	case 0x02: // SXY
+		HUC6280_ONLY();
+		SWAP_REGS( x, y );
+
+	case 0x22: // SAX
+		HUC6280_ONLY();
+		SWAP_REGS( a, x );
+
+	case 0x42: // SAY
+		HUC6280_ONLY();
+		SWAP_REGS( a, y );
+
+	case 0x62: // CLA
+		HUC6280_ONLY();
+		a = 0;
+		goto loop;
+
+	case 0x82: // CLX
+		HUC6280_ONLY();
+		x = 0;
+		goto loop;
+
+	case 0xC2: // CLY
+		HUC6280_ONLY();
+		y = 0;
+		goto loop;
+
+// Stack
+
+	case 0x48: // PHA
+		PUSH( a ); // verified
+		goto loop;
+
+	case 0xDA: // PHX
+		HUC6280_ONLY();
+		PUSH( x );
+		goto loop;
+
+	case 0x5A: // PHY
+		HUC6280_ONLY();
+		PUSH( y );
+		goto loop;
+
+	#define POP()  READ_LOW( sp ); sp = (sp - 0xFF) | 0x100
+
+	case 0x68: // PLA
+		a = nz = POP();
+		goto loop;
+
+	case 0xFA: // PLX
+		HUC6280_ONLY();
+		x = nz = POP();
+		goto loop;
+
+	case 0x7A: // PLY
+		HUC6280_ONLY();
+		y = nz = POP();
+		goto loop;
+
+	case 0x40:{// RTI
+		uint8_t temp = READ_LOW( sp );
+		pc  = READ_LOW( 0x100 | (sp - 0xFF) );
+		pc |= READ_LOW( 0x100 | (sp - 0xFE) ) * 0x100;
+		sp = (sp - 0xFD) | 0x100;
+		data = status;
+		SET_STATUS( temp );
+		cpu.r.status = status; // update externally-visible I flag
+		if ( (data ^ status) & st_i )
+		{
+			int32_t new_time = cpu.end_time_;
+			if ( !(status & st_i) && new_time > cpu.irq_time_ )
+				new_time = cpu.irq_time_;
+			int32_t delta = s.base - new_time;
+			s.base = new_time;
+			s_time += delta;
+		}
+		goto loop;
+	}
+
+	case 0x28:{// PLP
+		uint8_t temp = POP();
+		uint8_t changed = status ^ temp;
+		SET_STATUS( temp );
+		if ( !(changed & st_i) )
+			goto loop; // I flag didn't change
+		if ( status & st_i )
+			goto handle_sei;
+		goto handle_cli;
+	}
+	#undef POP
+
+	case 0x08: { // PHP
+		uint8_t temp;
+		CALC_STATUS( temp );
+		PUSH( temp | (st_b | st_r) );
+		goto loop;
+	}
+
+	case 0x7C: // JMP (ind,X)
+		HUC6280_ONLY();
+		data += x;/*FALLTHRU*/
+	case 0x6C:{// JMP (ind)
+		data += 0x100 * GET_MSB();
+		if ( P::huc6280 )
+		{
+			pc = GET_LE16( CODE( data ) );
+			goto loop;
+		}
+		pc = READ_PROG( data );
+		data = (data & 0xFF00) | ((data + 1) & 0xFF); // 6502 doesn't carry
+		pc |= 0x100 * READ_PROG( data );
+		goto loop;
+	}
+
+// Subroutine
+
+	case 0x44: // BSR
+		HUC6280_ONLY();
+		WRITE_LOW( 0x100 | (sp - 1), pc >> 8 );
+		sp = (sp - 2) | 0x100;
+		WRITE_LOW( sp, pc );
+		BRANCH( true );
+
+	case 0x00: // BRK
+		goto handle_brk;
+
+// Flags
+
+	case 0x38: // SEC
+		c = (uint16_t) ~0;
+		goto loop;
+
+	case 0x18: // CLC
+		c = 0;
+		goto loop;
+
+	case 0xB8: // CLV
+		status &= ~st_v;
+		goto loop;
+
+	case 0xD8: // CLD
+		status &= ~st_d;
+		goto loop;
+
+	case 0xF8: // SED
+		status |= st_d;
+		goto loop;
+
+	case 0x58: // CLI
+		if ( !(status & st_i) )
+			goto loop;
+		status &= ~st_i;
+	handle_cli: {
+		cpu.r.status = status; // update externally-visible I flag
+		int32_t delta = s.base - cpu.irq_time_;
+		if ( delta <= 0 )
+		{
+			if ( TIME < cpu.irq_time_ )
+				goto loop;
+			goto delayed_cli;
+		}
+		s.base = cpu.irq_time_;
+		s_time += delta;
+		if ( s_time < 0 )
+			goto loop;
+
+		if ( delta >= s_time + 1 )
+		{
+			// delayed irq until after next instruction
+			s.base += s_time + 1;
+			s_time = -1;
+			cpu.irq_time_ = s.base; // TODO: remove, as only to satisfy debug check in loop
+			goto loop;
+		}
+	delayed_cli:
+		debug_printf( "Delayed CLI not emulated\n" );
+		goto loop;
+	}
+
+	case 0x78: // SEI
+		if ( status & st_i )
+			goto loop;
+		status |= st_i;
+	handle_sei: {
+		cpu.r.status = status; // update externally-visible I flag
+		int32_t delta = s.base - cpu.end_time_;
+		s.base = cpu.end_time_;
+		s_time += delta;
+		if ( s_time < 0 )
+			goto loop;
+		debug_printf( "Delayed SEI not emulated\n" );
+		goto loop;
+	}
+
+// Special
+
+	case 0xEA: // NOP
+		goto loop;
+
+	case 0x53:{// TAM
+		HUC6280_ONLY();
+		uint8_t const bits = data; // avoid using data across function call
+		pc++;
+		for ( int i = 0; i < 8; i++ )
+			if ( bits & (1 << i) )
+				P::set_mmr( cpu, i, a );
+		goto loop;
+	}
+
+	case 0x43:{// TMA
+		HUC6280_ONLY();
+		pc++;
+		uint8_t const* in = P::mmr( cpu );
+		do
+		{
+			if ( data & 1 )
+				a = *in;
+			in++;
+		}
+		while ( (data >>= 1) != 0 );
+		goto loop;
+	}
+
+	case 0x03: // ST0
+	case 0x13: // ST1
+	case 0x23:{// ST2
+		HUC6280_ONLY();
+		int addr = opcode >> 4;
+		if ( addr )
+			addr++;
+		pc++;
+		FLUSH_TIME();
+		P::write_vdp( cpu, addr, data );
+		CACHE_TIME();
+		goto loop;
+	}
+
+	case 0x54: // CSL
+		HUC6280_ONLY();
+		debug_printf( "CSL not supported\n" );
+		illegal_encountered = true;
+		goto loop;
+
+	case 0xD4: // CSH
+		HUC6280_ONLY();
+		goto loop;
+
+	case 0xF4: // SET
+		HUC6280_ONLY();
+		debug_printf( "SET not handled\n" );
+		illegal_encountered = true;
+		goto loop;
+
+// Block transfer
+
+	{
+		unsigned in_alt;
+		int in_inc;
+		unsigned out_alt;
+		int out_inc;
+
+	case 0xE3: // TIA
+		HUC6280_ONLY();
+		in_alt  = 0;
+		goto bxfer_alt;
+
+	case 0xF3: // TAI
+		HUC6280_ONLY();
+		in_alt  = 1;
+	bxfer_alt:
+		in_inc  = in_alt ^ 1;
+		out_alt = in_inc;
+		out_inc = in_alt;
+		goto bxfer;
+
+	case 0xD3: // TIN
+		HUC6280_ONLY();
+		in_inc  = 1;
+		out_inc = 0;
+		goto bxfer_no_alt;
+
+	case 0xC3: // TDD
+		HUC6280_ONLY();
+		in_inc  = -1;
+		out_inc = -1;
+		goto bxfer_no_alt;
+
+	case 0x73: // TII
+		HUC6280_ONLY();
+		in_inc  = 1;
+		out_inc = 1;
+	bxfer_no_alt:
+		in_alt  = 0;
+		out_alt = 0;
+	bxfer:
+		unsigned in  = GET_LE16( instr + 0 );
+		unsigned out = GET_LE16( instr + 2 );
+		int count    = GET_LE16( instr + 4 );
+		if ( !count )
+			count = 0x10000;
+		pc += 6;
+		WRITE_LOW( 0x100 | (sp - 1), y );
+		WRITE_LOW( 0x100 | (sp - 2), a );
+		WRITE_LOW( 0x100 | (sp - 3), x );
+		FLUSH_TIME();
+		do
+		{
+			// TODO: reads from $0800-$1400 in I/O page return 0 and don't access I/O
+			uint8_t t = READ( in );
+			in += in_inc;
+			in &= 0xFFFF;
+			s.time += 6;
+			if ( in_alt )
+				in_inc = -in_inc;
+			WRITE( out, t );
+			out += out_inc;
+			out &= 0xFFFF;
+			if ( out_alt )
+				out_inc = -out_inc;
+		}
+		while ( --count );
+		CACHE_TIME();
+		goto loop;
+	}
+
+// Unofficial
+
+	default:
+		if ( P::huc6280 )
+		{
+			debug_printf( "Illegal opcode $%02X at $%04X\n", (int) opcode, (int) pc - 1 );
+			illegal_encountered = true;
+			goto loop;
+		}
+	unofficial:
+		switch ( opcode )
+		{
+		// SKW - Skip word
+		case 0x1C: case 0x3C: case 0x5C: case 0x7C: case 0xDC: case 0xFC:
+			HANDLE_PAGE_CROSSING( data + x );/*FALLTHRU*/
+		case 0x0C:
+			pc++;/*FALLTHRU*/
+		// SKB - Skip byte
+		case 0x74: case 0x04: case 0x14: case 0x34: case 0x44: case 0x54: case 0x64:
+		case 0x80: case 0x82: case 0x89: case 0xC2: case 0xD4: case 0xE2: case 0xF4:
+			pc++;
+			goto loop;
+
+		// NOP
+		case 0x1A: case 0x3A: case 0x5A: case 0x7A: case 0xDA: case 0xFA:
+			goto loop;
+
+		case 0xEB: // equivalent to SBC #imm
+			data ^= 0xFF;
+			goto adc_imm;
+		}
+
+		if ( !P::skip_illegal )
+		{
+			illegal_encountered = true;
+			pc--;
+			goto stop;
+		}
+
+		switch ( opcode )
+		{
+		case 0xF2: // HLT (Nes_Cpu::bad_opcode)
+			pc--;/*FALLTHRU*/
+		case 0x02: case 0x12: case 0x22: case 0x32: case 0x42: case 0x52:
+		case 0x62: case 0x72: case 0x92: case 0xB2: case 0xD2:
+			goto stop;
+		}
+
+		{
+			// skip over proper number of bytes
+			static unsigned char const illop_lens [8] = {
+				0x40, 0x40, 0x40, 0x80, 0x40, 0x40, 0x80, 0xA0
+			};
+			int16_t len = illop_lens [opcode >> 2 & 7] >> (opcode << 1 & 6) & 3;
+			if ( opcode == 0x9C )
+				len = 2;
+			pc += len;
+			P::count_error( cpu );
+
+			if ( (opcode >> 4) == 0x0B )
+			{
+				if ( opcode == 0xB3 )
+					data = READ_LOW( data );
+				if ( opcode != 0xB7 )
+					HANDLE_PAGE_CROSSING( data + y );
+			}
+			goto loop;
+		}
+	}
+	assert( false );
+
+	int result_;
+handle_brk:
+	if ( !P::huc6280 && P::idle_addr != 0 && (pc - 1) >= P::idle_addr )
+		goto idle_done;
+	pc++;
+	result_ = brk_vector;
+	debug_printf( "BRK executed\n" );
+
+interrupt:
+	{
+		s_time += 7;
+
+		WRITE_LOW( 0x100 | (sp - 1), pc >> 8 );
+		WRITE_LOW( 0x100 | (sp - 2), pc );
+		pc = GET_LE16( CODE( vectors ) + result_ );
+
+		sp = (sp - 3) | 0x100;
+		uint8_t temp;
+		CALC_STATUS( temp );
+		temp |= st_r;
+		if ( result_ == brk_vector )
+			temp |= st_b;
+		WRITE_LOW( sp, temp );
+
+		if ( P::int_clears_d )
+			status &= ~st_d;
+		status |= st_i;
+		cpu.r.status = status; // update externally-visible I flag
+
+		int32_t delta = s.base - cpu.end_time_;
+		s.base = cpu.end_time_;
+		s_time += delta;
+		goto loop;
+	}
+
+idle_done:
+	if ( P::huc6280 )
+	{
+		// wait for interrupt or end_time
+		s_time = 0;
+		goto out_of_time;
+	}
+	pc--;
+	goto stop;
+
+out_of_time:
+	pc--;
+	FLUSH_TIME();
+	result_ = P::done( cpu );
+	CACHE_TIME();
+	if ( result_ >= 0 )
+		goto interrupt;
+	if ( s_time < 0 )
+		goto loop;
+
+stop:
+
+	s.time = s_time;
+
+	cpu.r.pc = pc;
+	cpu.r.sp = GET_SP();
+	cpu.r.a = a;
+	cpu.r.x = x;
+	cpu.r.y = y;
+
+	{
+		uint8_t temp;
+		CALC_STATUS( temp );
+		cpu.r.status = temp;
+	}
+
+	cpu.state_ = s;
+	cpu.state = &cpu.state_;
+
+	if ( P::skip_illegal )
+		return s_time < 0; // true if stopped by HLT before end_time
+	return illegal_encountered;
+}
+
+#endif
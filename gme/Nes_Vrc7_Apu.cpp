@@ -1,5 +1,7 @@
 #include "Nes_Vrc7_Apu.h"
 
+#include "Ym2413_Emu.h"
+
 extern "C" {
 #include "ext/emu2413.h"
 }
@@ -14,6 +16,7 @@ static unsigned char vrc7_inst[(16 + 3) * 8] =
 };
 
 static int const period = 36; // NES CPU clocks per FM clock
+static int const block_size = 256; // FM clocks rendered per emu2413 call
 
 Nes_Vrc7_Apu::Nes_Vrc7_Apu()
 {
@@ -22,7 +25,7 @@ Nes_Vrc7_Apu::Nes_Vrc7_Apu()
 
 blargg_err_t Nes_Vrc7_Apu::init()
 {
-	CHECK_ALLOC( opll = OPLL_new( 3579545, 3579545 / 72 ) );
+	CHECK_ALLOC( opll = Ym2413_Emu::new_opll() );
 	OPLL_SetChipMode((OPLL *) opll, 1);
 	OPLL_setPatch((OPLL *) opll, vrc7_inst);
 
@@ -168,51 +171,69 @@ void Nes_Vrc7_Apu::run_until( blip_time_t end_time )
 	require( end_time > next_time );
 
 	blip_time_t time = next_time;
-	void* opll = this->opll; // cache
+	OPLL* opll = (OPLL*) this->opll; // cache
 	Blip_Buffer* const mono_output = mono.output;
-	e_int32 buffer [2];
-	e_int32* buffers[2] = {&buffer[0], &buffer[1]};
-	if ( mono_output )
+
+	// emu2413 fills a block of samples for every channel at once
+	e_int32 buf [osc_count] [block_size];
+	e_int32* bufs [osc_count];
+	for ( int i = 0; i < osc_count; ++i )
+		bufs [i] = buf [i];
+
+	if ( !mono_output )
+		mono.last_amp = 0;
+
+	do
 	{
-		// optimal case
-		do
+		int count = (end_time - time + period - 1) / period;
+		if ( count > block_size )
+			count = block_size;
+		OPLL_calc_channels( opll, bufs, count );
+
+		if ( mono_output )
 		{
-			OPLL_calc_stereo( (OPLL *) opll, buffers, 1, -1 );
-			int amp = buffer [0] + buffer [1];
-			int delta = amp - mono.last_amp;
-			if ( delta )
+			// optimal case
+			int last_amp = mono.last_amp;
+			for ( int n = 0; n < count; ++n )
 			{
-				mono.last_amp = amp;
-				synth.offset_inline( time, delta, mono_output );
+				int amp = 0;
+				for ( int i = 0; i < osc_count; ++i )
+					amp += buf [i] [n];
+				amp <<= 4; // << 3 for each of left and right
+				int delta = amp - last_amp;
+				if ( delta )
+				{
+					last_amp = amp;
+					synth.offset_inline( time + n * period, delta, mono_output );
+				}
 			}
-			time += period;
+			mono.last_amp = last_amp;
 		}
-		while ( time < end_time );
-	}
-	else
-	{
-		mono.last_amp = 0;
-		do
+		else
 		{
-			OPLL_advance( (OPLL *) opll );
 			for ( int i = 0; i < osc_count; ++i )
 			{
 				Vrc7_Osc& osc = oscs [i];
 				if ( osc.output )
 				{
-					OPLL_calc_stereo( (OPLL *) opll, buffers, 1, i );
-					int amp = buffer [0] + buffer [1];
-					int delta = amp - osc.last_amp;
-					if ( delta )
+					e_int32 const* in = buf [i];
+					int last_amp = osc.last_amp;
+					for ( int n = 0; n < count; ++n )
 					{
-						osc.last_amp = amp;
-						synth.offset( time, delta, osc.output );
+						int amp = in [n] << 4;
+						int delta = amp - last_amp;
+						if ( delta )
+						{
+							last_amp = amp;
+							synth.offset( time + n * period, delta, osc.output );
+						}
 					}
+					osc.last_amp = last_amp;
 				}
 			}
-			time += period;
 		}
-		while ( time < end_time );
+		time += count * period;
 	}
+	while ( time < end_time );
 	next_time = time;
 }
@@ -476,6 +476,7 @@ void Nsf_Emu::cpu_write_misc( nes_addr_t addr, int data )
 		{
 			if ( (unsigned) (addr - fds->io_addr) < fds->io_size )
 			{
+				count_apu_write();
 				fds->write( time(), addr, data);
 				return;
 			}
@@ -486,6 +487,7 @@ void Nsf_Emu::cpu_write_misc( nes_addr_t addr, int data )
 			switch ( addr )
 			{
 			case Nes_Namco_Apu::data_reg_addr:
+				count_apu_write();
 				namco->write_data( time(), data );
 				return;
 			
@@ -504,6 +506,7 @@ void Nsf_Emu::cpu_write_misc( nes_addr_t addr, int data )
 				return;
 			
 			case Nes_Fme7_Apu::data_addr:
+				count_apu_write();
 				fme7->write_data( time(), data );
 				return;
 			}
@@ -515,6 +518,7 @@ void Nsf_Emu::cpu_write_misc( nes_addr_t addr, int data )
 			unsigned osc = unsigned (addr - Nes_Vrc6_Apu::base_addr) / Nes_Vrc6_Apu::addr_step;
 			if ( osc < Nes_Vrc6_Apu::osc_count && reg < Nes_Vrc6_Apu::reg_count )
 			{
+				count_apu_write();
 				vrc6->write_osc( time(), osc, reg, data );
 				return;
 			}
@@ -524,6 +528,7 @@ void Nsf_Emu::cpu_write_misc( nes_addr_t addr, int data )
 		{
 			if ( (unsigned) (addr - mmc5->regs_addr) < mmc5->regs_size)
 			{
+				count_apu_write();
 				mmc5->write_register( time(), addr, data );
 				return;
 			}
@@ -553,6 +558,7 @@ void Nsf_Emu::cpu_write_misc( nes_addr_t addr, int data )
 
 			if ( (unsigned) (addr - 0x9028) <= 0x08 )
 			{
+				count_apu_write();
 				vrc7->write_data( time(), data );
 				return;
 			}
@@ -626,6 +632,11 @@ blargg_err_t Nsf_Emu::start_track_( int track )
 	return 0;
 }
 
+int64_t Nsf_Emu::idle_clocks_() const
+{
+	return cpu::skipped_clocks();
+}
+
 blargg_err_t Nsf_Emu::run_clocks( blip_time_t& duration, int )
 {
 	set_time( 0 );
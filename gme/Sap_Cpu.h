@@ -43,6 +43,9 @@ public:
 	sap_time_t end_time() const         { return end_time_; }
 	void set_end_time( sap_time_t );
 
+	// Number of clocks spent in idle loops that were skipped rather than emulated
+	int64_t skipped_clocks() const { return skipped_clocks_; }
+
 public:
 	Sap_Cpu() { state = &state_; }
 	enum { irq_inhibit = 0x04 };
@@ -55,9 +58,13 @@ private:
 	state_t state_;
 	sap_time_t irq_time_;
 	sap_time_t end_time_;
+	int64_t skipped_clocks_;
 	uint8_t* mem;
 
 	inline sap_time_t update_end_time( sap_time_t end, sap_time_t irq );
+
+	struct policy;
+	template<class P> friend class Cpu_6502;
 };
 
 inline sap_time_t Sap_Cpu::update_end_time( sap_time_t t, sap_time_t irq )
@@ -388,6 +388,7 @@ void Sap_Emu::cpu_write_( sap_addr_t addr, int data )
 	if ( (addr ^ Sap_Apu::start_addr) <= (Sap_Apu::end_addr - Sap_Apu::start_addr) )
 	{
 		GME_APU_HOOK( this, addr - Sap_Apu::start_addr, data );
+		count_apu_write();
 		apu.write_data( time() & time_mask, addr, data );
 		return;
 	}
@@ -396,6 +397,7 @@ void Sap_Emu::cpu_write_( sap_addr_t addr, int data )
 			info.stereo )
 	{
 		GME_APU_HOOK( this, addr - 0x10 - Sap_Apu::start_addr + 10, data );
+		count_apu_write();
 		apu2.write_data( time() & time_mask, addr ^ 0x10, data );
 		return;
 	}
@@ -418,6 +420,11 @@ inline void Sap_Emu::call_play()
 	}
 }
 
+int64_t Sap_Emu::idle_clocks_() const
+{
+	return cpu::skipped_clocks();
+}
+
 blargg_err_t Sap_Emu::run_clocks( blip_time_t& duration, int )
 {
 	set_time( 0 );
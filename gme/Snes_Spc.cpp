@@ -160,6 +160,7 @@ void Snes_Spc::reset_time_regs()
 	m.echo_accessed = 0;
 	m.spc_time      = 0;
 	m.dsp_time      = 0;
+	m.skipped_clocks = 0;
 	#if SPC_LESS_ACCURATE
 		m.dsp_time = clocks_per_sample + 1;
 	#endif
@@ -93,6 +93,9 @@ public:
 	// Skips count samples. Several times faster than play() when using fast DSP.
 	blargg_err_t skip( int count );
 
+	// CPU clocks skipped in idle loops since SPC was loaded or reset
+	int64_t skipped_clocks() const { return m.skipped_clocks; }
+
 // State save/load (only available with accurate DSP)
 
 #if !SPC_NO_COPY_STATE_FUNCS
@@ -170,6 +173,7 @@ private:
 
 		rel_time_t  dsp_time;
 		time_t      spc_time;
+		int64_t     skipped_clocks;
 		bool        echo_accessed;
 
 		int         tempo;
@@ -240,6 +244,7 @@ private:
 	unsigned CPU_mem_bit   ( uint16_t pc, rel_time_t );
 
 	bool check_echo_access ( int addr );
+	rel_time_t skip_idle_loop( int loop_pc, rel_time_t, int dp );
 	uint8_t* run_until_( time_t end_time );
 
 	struct spc_file_t
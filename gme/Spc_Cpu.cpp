@@ -32,6 +32,16 @@ Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA */
 	#define SPC_MORE_ACCURACY 0
 #endif
 
+// Skips iterations of idle loops instead of emulating them. Disabled when
+// accesses have timing side effects or opcodes are being hooked.
+#ifndef SPC_IDLE_SKIP
+	#if SPC_MORE_ACCURACY || defined (SPC_CPU_OPCODE_HOOK)
+		#define SPC_IDLE_SKIP 0
+	#else
+		#define SPC_IDLE_SKIP 1
+	#endif
+#endif
+
 #ifdef BLARGG_ENABLE_OPTIMIZER
 	#include BLARGG_ENABLE_OPTIMIZER
 #endif
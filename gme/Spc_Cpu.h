@@ -103,6 +103,89 @@ unsigned Snes_Spc::CPU_mem_bit( uint16_t pc, rel_time_t rel_time )
 	return t << 8 & 0x100;
 }
 
+//// Idle loops
+
+#if SPC_IDLE_SKIP
+// Most drivers wait in loops like "- MOV Y,$FD / BEQ -" or "- CMP A,$F4 / BNE -"
+// whose only effect until the value read changes is to use up time. Timers only
+// change at known times and ports don't change within a run_until_() call, so
+// whole iterations can be skipped. Called just after branch back to loop_pc was
+// taken. Returns time after skipping as many iterations as give the same result.
+Snes_Spc::rel_time_t Snes_Spc::skip_idle_loop( int loop_pc, rel_time_t rel_time, int dp )
+{
+	uint8_t const* const ram = RAM;
+	int const opcode = ram [loop_pc];
+	bool const is_mov = (opcode & 0xF0) >= 0xE0;
+	int addr;
+	int len;
+	switch ( opcode )
+	{
+	case 0xE4: // MOV A,dp
+	case 0xF8: // MOV X,dp
+	case 0xEB: // MOV Y,dp
+	case 0x64: // CMP A,dp
+	case 0x3E: // CMP X,dp
+	case 0x7E: // CMP Y,dp
+		addr = dp + ram [loop_pc + 1];
+		len = 2;
+		break;
+
+	case 0xE5: // MOV A,abs
+	case 0xE9: // MOV X,abs
+	case 0xEC: // MOV Y,abs
+	case 0x65: // CMP A,abs
+	case 0x1E: // CMP X,abs
+	case 0x5E: // CMP Y,abs
+		addr = READ_PROG16( loop_pc + 1 );
+		len = 3;
+		break;
+
+	default:
+		return rel_time;
+	}
+
+	// Instruction must be followed immediately by the branch just taken
+	int const branch = ram [(loop_pc + len) & 0xFFFF];
+	if ( ram [(loop_pc + len + 1) & 0xFFFF] != (uint8_t) (-2 - len) )
+		return rel_time;
+
+	int const period = m.cycle_table [opcode] + m.cycle_table [branch];
+	int count = -rel_time / period; // iterations that fit before end
+
+	int const reg = addr - 0xF0;
+	if ( (unsigned) reg < reg_count )
+	{
+		if ( reg == r_dspdata )
+			return rel_time;
+
+		int const ti = reg - r_t0out;
+		if ( ti >= 0 )
+		{
+			// Reading counter clears it, so only loop while it reads zero can be
+			// skipped, up to the iteration that would see it become non-zero
+			if ( !is_mov || branch != 0xF0 )
+				return rel_time;
+
+			Timer const* t = &m.timers [ti];
+			if ( t->enabled )
+			{
+				int remain = IF_0_THEN_256( t->period - t->divider );
+				rel_time_t tick = t->next_time + TIMER_MUL( t, remain - 1 );
+				int before = tick - (rel_time + m.cycle_table [opcode]);
+				if ( before <= 0 )
+					return rel_time;
+				int n = (before + period - 1) / period;
+				if ( count > n )
+					count = n;
+			}
+		}
+	}
+
+	m.skipped_clocks += count * period;
+	return rel_time + count * period;
+}
+#endif
+
 //// Status flag handling
 
 // Hex value in name to clarify code and bit shifting.
@@ -211,11 +294,31 @@ loop:
 	goto loop;\
 }
 
+// Branch back over a single two or three byte instruction might be an idle loop
+#if SPC_IDLE_SKIP
+	#define IDLE_BRANCH( cond )\
+	{\
+		pc++;\
+		pc += (int8_t) data;\
+		if ( cond )\
+		{\
+			if ( (uint8_t) (data + 5) <= 1 )\
+				rel_time = skip_idle_loop( pc, rel_time, dp );\
+			goto loop;\
+		}\
+		pc -= (int8_t) data;\
+		rel_time -= 2;\
+		goto loop;\
+	}
+#else
+	#define IDLE_BRANCH( cond ) BRANCH( cond )
+#endif
+
 	case 0xF0: // BEQ
-		BRANCH( !(uint8_t) nz ) // 89% taken
+		IDLE_BRANCH( !(uint8_t) nz ) // 89% taken
 
 	case 0xD0: // BNE
-		BRANCH( (uint8_t) nz )
+		IDLE_BRANCH( (uint8_t) nz )
 
 	case 0x3F:{// CALL
 		int old_addr = GET_PC() + 2;
@@ -181,6 +181,85 @@ inline void Spc_Dsp::run_counter( int i )
 	(*m.counter_select [rate] & counter_mask [rate])
 
 
+//// BRR decoding
+
+// 0: >>1  1: <<0  2: <<1 ... 12: <<11  13-15: >>4 <<11
+static unsigned char const brr_shifts [16 * 2] = {
+	13,12,12,12,12,12,12,12,12,12,12, 12, 12, 16, 16, 16,
+	 0, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 11, 11, 11
+};
+
+// Decodes the four samples in nybbles (0xABCD order) into out [0 to 3].
+// prev2 and prev1 are the two samples before them.
+static inline void decode_brr( int header, int nybbles, int prev2, int prev1, int* out )
+{
+	int const scale = header >> 4;
+	int const right_shift = brr_shifts [scale];
+	int const left_shift  = brr_shifts [scale + 16];
+	int const filter = header & 0x0C;
+
+	for ( int* end = out + 4; out < end; out++, nybbles <<= 4 )
+	{
+		// Extract upper nybble and scale appropriately. Every cast is
+		// necessary to maintain correctness and avoid undef behavior
+		int s = int16_t(uint16_t((int16_t) nybbles >> right_shift) << left_shift);
+
+		// Apply IIR filter (8 is the most commonly used)
+		int const p1 = prev1;
+		int const p2 = prev2 >> 1;
+		if ( filter >= 8 )
+		{
+			s += p1;
+			s -= p2;
+			if ( filter == 8 ) // s += p1 * 0.953125 - p2 * 0.46875
+			{
+				s += p2 >> 4;
+				s += (p1 * -3) >> 6;
+			}
+			else // s += p1 * 0.8984375 - p2 * 0.40625
+			{
+				s += (p1 * -13) >> 7;
+				s += (p2 * 3) >> 4;
+			}
+		}
+		else if ( filter ) // s += p1 * 0.46875
+		{
+			s += p1 >> 1;
+			s += (-p1) >> 5;
+		}
+
+		// Adjust and write sample
+		CLAMP16( s );
+		s = (int16_t) (s * 2);
+		*out = s;
+		prev2 = prev1;
+		prev1 = s;
+	}
+}
+
+// Decodes whole block at addr, which must not wrap around end of RAM
+static void fill_brr_block( Spc_Dsp::brr_block_t& b, uint8_t const* ram, int addr,
+		int header, int prev2, int prev1 )
+{
+	b.addr = (uint16_t) addr;
+	memcpy( b.raw, &ram [addr], sizeof b.raw );
+	b.raw [0] = (uint8_t) header;
+	b.prev [0] = (short) prev2;
+	b.prev [1] = (short) prev1;
+
+	for ( int i = 0; i < 4; i++ )
+	{
+		int out [4];
+		decode_brr( header, b.raw [i * 2 + 1] * 0x100 + b.raw [i * 2 + 2], prev2, prev1, out );
+		for ( int n = 0; n < 4; n++ )
+			b.samples [i * 4 + n] = (short) out [n];
+		prev2 = out [2];
+		prev1 = out [3];
+	}
+}
+
+
+
 //// Emulation
 
 void Spc_Dsp::run( int clock_count )
@@ -476,16 +555,17 @@ void Spc_Dsp::run( int clock_count )
 				if ( old_pos >= 0x4000 )
 				{
 					// Arrange the four input nybbles in 0xABCD order for easy decoding
-					int nybbles = ram [(v->brr_addr + v->brr_offset) & 0xFFFF] * 0x100 +
-							ram [(v->brr_addr + v->brr_offset + 1) & 0xFFFF];
+					int const block = v->brr_addr;
+					int brr_offset = v->brr_offset;
+					int const nybbles = ram [(block + brr_offset) & 0xFFFF] * 0x100 +
+							ram [(block + brr_offset + 1) & 0xFFFF];
+					int const first = (brr_offset - 1) * 2; // index of first sample in block
 
 					// Advance read position
-					int const brr_block_size = 9;
-					int brr_offset = v->brr_offset;
 					if ( (brr_offset += 2) >= brr_block_size )
 					{
 						// Next BRR block
-						int brr_addr = (v->brr_addr + brr_block_size) & 0xFFFF;
+						int brr_addr = (block + brr_block_size) & 0xFFFF;
 						assert( brr_offset == brr_block_size );
 						if ( brr_header & 1 )
 						{
@@ -498,59 +578,47 @@ void Spc_Dsp::run( int clock_count )
 					}
 					v->brr_offset = brr_offset;
 
-					// Decode
-
-					// 0: >>1  1: <<0  2: <<1 ... 12: <<11  13-15: >>4 <<11
-					static unsigned char const shifts [16 * 2] = {
-						13,12,12,12,12,12,12,12,12,12,12, 12, 12, 16, 16, 16,
-						 0, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 11, 11, 11
-					};
-					int const scale = brr_header >> 4;
-					int const right_shift = shifts [scale];
-					int const left_shift  = shifts [scale + 16];
-
 					// Write to next four samples in circular buffer
 					int* pos = v->buf_pos;
-					int* end;
-
-					// Decode four samples
-					for ( end = pos + 4; pos < end; pos++, nybbles <<= 4 )
+					int const p2 = pos [brr_buf_size - 2];
+					int const p1 = pos [brr_buf_size - 1];
+
+					// Use samples decoded earlier if everything they depend on is the
+					// same: header, the two bytes, and the two samples before them
+					// (unless filter 0 is used)
+					short const* cached = NULL;
+					if ( block <= 0x10000 - brr_block_size )
 					{
-						// Extract upper nybble and scale appropriately. Every cast is
-						// necessary to maintain correctness and avoid undef behavior
-						int s = int16_t(uint16_t((int16_t) nybbles >> right_shift) << left_shift);
-
-						// Apply IIR filter (8 is the most commonly used)
-						int const filter = brr_header & 0x0C;
-						int const p1 = pos [brr_buf_size - 1];
-						int const p2 = pos [brr_buf_size - 2] >> 1;
-						if ( filter >= 8 )
+						brr_block_t& b = brr_cache [block & (brr_cache_size - 1)];
+						short const* prev = (first ? &b.samples [first - 2] : b.prev);
+						if ( b.addr == block && b.raw [0] == brr_header &&
+								b.raw [first / 2 + 1] == (nybbles >> 8) &&
+								b.raw [first / 2 + 2] == (nybbles & 0xFF) &&
+								(!(brr_header & 0x0C) || (prev [0] == p2 && prev [1] == p1)) )
 						{
-							s += p1;
-							s -= p2;
-							if ( filter == 8 ) // s += p1 * 0.953125 - p2 * 0.46875
-							{
-								s += p2 >> 4;
-								s += (p1 * -3) >> 6;
-							}
-							else // s += p1 * 0.8984375 - p2 * 0.40625
-							{
-								s += (p1 * -13) >> 7;
-								s += (p2 * 3) >> 4;
-							}
+							cached = &b.samples [first];
 						}
-						else if ( filter ) // s += p1 * 0.46875
+						else if ( !first )
 						{
-							s += p1 >> 1;
-							s += (-p1) >> 5;
+							fill_brr_block( b, ram, block, brr_header, p2, p1 );
+							cached = b.samples;
 						}
+					}
 
-						// Adjust and write sample
-						CLAMP16( s );
-						s = (int16_t) (s * 2);
-						pos [brr_buf_size] = pos [0] = s; // second copy simplifies wrap-around
+					if ( cached )
+					{
+						for ( int n = 0; n < 4; n++ )
+							pos [brr_buf_size + n] = pos [n] = cached [n];
+					}
+					else
+					{
+						int out [4];
+						decode_brr( brr_header, nybbles, p2, p1, out );
+						for ( int n = 0; n < 4; n++ )
+							pos [brr_buf_size + n] = pos [n] = out [n]; // second copy simplifies wrap-around
 					}
 
+					pos += 4;
 					if ( pos >= &v->buf [brr_buf_size] )
 						pos = v->buf;
 					v->buf_pos = pos;
@@ -665,6 +733,7 @@ void Spc_Dsp::mute_voices( int mask )
 Spc_Dsp::Spc_Dsp()
 {
 	blarg_memset(&m, 0, sizeof(state_t));
+	blarg_memset(brr_cache, 0, sizeof(brr_cache)); // all zero is a valid decoded block
 	blarg_memset(&voice_volumes_, 0, sizeof(voice_volumes_));
 	blarg_memset(&voice_keycodes_, 0, sizeof(voice_keycodes_));
 	blarg_memset(&voice_states_, 0, sizeof(voice_states_));
@@ -115,6 +115,18 @@ public:
 		int volume [2];         // copy of volume from DSP registers, with surround disabled
 		int enabled;            // -1 if enabled, 0 if muted
 	};
+
+	// Decoded BRR block, reused whenever a voice plays the same block again
+	// with the same filter state
+	enum { brr_block_size = 9 };
+	enum { brr_cache_size = 1024 }; // power of 2
+	struct brr_block_t
+	{
+		uint8_t  raw [brr_block_size]; // header and data that were decoded
+		uint16_t addr;
+		short    prev [2];             // two samples before block
+		short    samples [16];
+	};
 private:
 	struct state_t
 	{
@@ -155,6 +167,7 @@ private:
 		sample_t extra [extra_size];
 	};
 	state_t m;
+	brr_block_t brr_cache [brr_cache_size];
 	int* voice_volumes_[voice_count];
 	int voice_keycodes_[voice_count];
 	int voice_states_[voice_count];
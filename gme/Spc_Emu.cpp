@@ -31,6 +31,8 @@ using std::min;
 using std::max;
 #endif
 
+double const resampler_rolloff = 0.9965;
+
 // TODO: support Spc_Filter's bass
 
 Spc_Emu::Spc_Emu()
@@ -258,6 +260,8 @@ struct Spc_File : Gme_Info_
 		get_spc_info( header, xid6.begin(), (long)xid6.size(), out );
 		return 0;
 	}
+
+	long preferred_sample_rate_() const { return Spc_Emu::native_sample_rate; }
 };
 
 static Music_Emu* new_spc_emu () { return BLARGG_NEW Spc_Emu ; }
@@ -276,11 +280,22 @@ blargg_err_t Spc_Emu::set_sample_rate_( long sample_rate )
 	if ( sample_rate != native_sample_rate )
 	{
 		RETURN_ERR( resampler.buffer_size( native_sample_rate / 20 * 2 ) );
-		resampler.time_ratio( (double) native_sample_rate / sample_rate, 0.9965 );
+		setup_resampler( sample_rate );
 	}
 	return 0;
 }
 
+void Spc_Emu::setup_resampler( long rate )
+{
+	resampler.set_width( quality() == gme_quality_draft ? draft_resampler_width : resampler_width );
+	resampler.time_ratio( (double) native_sample_rate / rate, resampler_rolloff );
+}
+
+int64_t Spc_Emu::idle_clocks_() const
+{
+	return apu.skipped_clocks();
+}
+
 void Spc_Emu::enable_accuracy_( bool b )
 {
 	Music_Emu::enable_accuracy_( b );
@@ -306,6 +321,10 @@ blargg_err_t Spc_Emu::load_mem_( byte const* in, long size )
 	set_voice_count( Snes_Spc::voice_count );
 	if ( size < Snes_Spc::spc_min_file_size )
 		return gme_wrong_file_type;
+
+	// quality may have changed since sample rate was set
+	if ( sample_rate() != native_sample_rate )
+		setup_resampler( sample_rate() );
 	return check_spc_header( in );
 }
 
@@ -336,6 +355,7 @@ blargg_err_t Spc_Emu::start_track_( int track )
 blargg_err_t Spc_Emu::play_and_filter( long count, sample_t out [] )
 {
 	RETURN_ERR( apu.play( count, out ) );
+	emu_stats().counts.cpu_clocks += count / 2 * Snes_Spc::clocks_per_sample;
 	filter.run( out, count );
 	return 0;
 }
@@ -353,6 +373,7 @@ blargg_err_t Spc_Emu::skip_( long count )
 	if ( count > 0 )
 	{
 		RETURN_ERR( apu.skip( count ) );
+		emu_stats().counts.cpu_clocks += count / 2 * Snes_Spc::clocks_per_sample;
 		filter.clear();
 	}
 
@@ -370,7 +391,12 @@ blargg_err_t Spc_Emu::play_( long count, sample_t* out )
 	long remain = count;
 	while ( remain > 0 )
 	{
-		remain -= resampler.read( &out [count - remain], remain );
+		{
+			Emu_Stats_Timer timer( emu_stats(), emu_stats().counts.resample_nsec );
+			long n = resampler.read( &out [count - remain], remain );
+			emu_stats().counts.samples_resampled += n;
+			remain -= n;
+		}
 		if ( remain > 0 )
 		{
 			long n = resampler.max_write();
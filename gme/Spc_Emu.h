@@ -70,11 +70,15 @@ protected:
 	void disable_echo_( bool disable );
 	void set_tempo_( double );
 	void enable_accuracy_( bool );
+	int64_t idle_clocks_() const;
+	long preferred_sample_rate_() const { return native_sample_rate; }
 	const uint8_t* regs_( ) { return regs(); }
 private:
 	byte const* file_data;
 	long        file_size;
-	Fir_Resampler<24> resampler;
+	enum { resampler_width = 24, draft_resampler_width = 8 };
+	Fir_Resampler<resampler_width> resampler;
+	void setup_resampler( long rate );
 	SPC_Filter filter;
 	Snes_Spc apu;
 
@@ -23,6 +23,7 @@ Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA */
 double const fm_gain = 3.0; // FM emulators are internally quieter to avoid 16-bit overflow
 double const rolloff = 0.990;
 double const oversample_factor = 1.0;
+double const draft_oversample_factor = 0.5; // YM2612 at half the output rate, if faster
 
 #ifndef min
 #define min(x,y) ((x > y) ? y : x)
@@ -38,6 +39,7 @@ using std::max;
 Vgm_Emu::Vgm_Emu()
 {
 	disable_oversampling_ = false;
+	fm_native_rate = 0;
 	psg_rate   = 0;
 	set_type( gme_vgm_type );
 
@@ -169,6 +171,22 @@ static blargg_err_t check_vgm_header( Vgm_Emu::header_t const& h )
 	return 0;
 }
 
+// FM chip's own sample rate, or 0 if there's no FM chip. Pre-1.10 headers give a
+// single clock for either chip, so chip is guessed from clock here rather than
+// by scanning commands as Vgm_Emu does.
+static long vgm_fm_native_rate( Vgm_Emu::header_t const& h )
+{
+	long ym2612_rate = get_le32( h.ym2612_rate ) & ~0xC0000000;
+	long ym2413_rate = get_le32( h.ym2413_rate ) & ~0xC0000000;
+	if ( ym2413_rate && get_le32( h.version ) < 0x110 && ym2413_rate > 5000000 )
+		ym2612_rate = ym2413_rate;
+	if ( ym2612_rate )
+		return long (ym2612_rate / 144.0 + 0.5);
+	if ( ym2413_rate )
+		return long (ym2413_rate / 72.0 + 0.5);
+	return 0;
+}
+
 struct Vgm_File : Gme_Info_
 {
 	Vgm_Emu::header_t h;
@@ -209,6 +227,8 @@ struct Vgm_File : Gme_Info_
 			parse_gd3( gd3.begin(), gd3.end(), out );
 		return 0;
 	}
+
+	long preferred_sample_rate_() const { return vgm_fm_native_rate( h ); }
 };
 
 static Music_Emu* new_vgm_emu () { return BLARGG_NEW Vgm_Emu ; }
@@ -384,14 +404,19 @@ blargg_err_t Vgm_Emu::setup_fm()
 		update_fm_rates( &ym2413_rate, &ym2612_rate );
 
 	uses_fm = false;
+	fm_native_rate = 0;
 
-	fm_rate = blip_buf.sample_rate() * oversample_factor;
+	bool const draft = (quality() == gme_quality_draft);
+	Dual_Resampler::draft_resampling( draft );
+	bool const half_rate = draft && ym2612_rate_saves_time;
+	fm_rate = blip_buf.sample_rate() * (half_rate ? draft_oversample_factor : oversample_factor);
 
 	if ( ym2612_rate )
 	{
 		ym2612_rate &= ~0xC0000000;
 		uses_fm = true;
-		if ( disable_oversampling_ )
+		fm_native_rate = long (ym2612_rate / 144.0 + 0.5);
+		if ( disable_oversampling_ || quality() == gme_quality_high )
 			fm_rate = ym2612_rate / 144.0;
 		Dual_Resampler::setup( fm_rate / blip_buf.sample_rate(), rolloff, fm_gain * gain() );
 		RETURN_ERR( ym2612[0].set_rate( fm_rate, ym2612_rate ) );
@@ -408,8 +433,10 @@ blargg_err_t Vgm_Emu::setup_fm()
 	{
 		ym2413_rate &= ~0xC0000000;
 		uses_fm = true;
-		if ( disable_oversampling_ )
-			fm_rate = ym2413_rate / 72.0;
+		fm_native_rate = long (ym2413_rate / 72.0 + 0.5);
+		// emu2413 always makes one sample per 72 clocks; the resampler
+		// takes care of clocks other than NTSC's
+		fm_rate = ym2413_rate / 72.0;
 		Dual_Resampler::setup( fm_rate / blip_buf.sample_rate(), rolloff, fm_gain * gain() );
 		int result = ym2413[0].set_rate( fm_rate, ym2413_rate );
 		if ( result == 2 )
@@ -505,6 +532,6 @@ blargg_err_t Vgm_Emu::play_( long count, sample_t* out )
 	if ( !uses_fm )
 		return Classic_Emu::play_( count, out );
 
-	Dual_Resampler::dual_play( count, out, blip_buf );
+	Dual_Resampler::dual_play( count, out, blip_buf, emu_stats() );
 	return 0;
 }
@@ -72,10 +72,12 @@ protected:
 	void mute_voices_( int mask ) override;
 	void set_voice( int, Blip_Buffer*, Blip_Buffer*, Blip_Buffer* ) override;
 	void update_eq( blip_eq_t const& ) override;
+	long preferred_sample_rate_() const override { return fm_native_rate; }
 private:
 	// removed; use disable_oversampling() and set_tempo() instead
 	Vgm_Emu( bool oversample, double tempo = 1.0 );
 	double fm_rate;
+	long fm_native_rate; // FM chip's own sample rate, or 0 if none
 	long psg_rate;
 	long vgm_rate;
 	bool disable_oversampling_;
@@ -152,6 +152,7 @@ blip_time_t Vgm_Emu_Impl::run_commands( vgm_time_t end_time )
 			break;
 
 		case cmd_psg:
+			count_apu_write();
 			psg[0].write_data( to_blip_time( vgm_time ), *pos++ );
 			break;
 
@@ -160,6 +161,7 @@ blip_time_t Vgm_Emu_Impl::run_commands( vgm_time_t end_time )
 			break;
 
 		case cmd_psg_2:
+			count_apu_write();
 			psg[1].write_data( to_blip_time( vgm_time ), *pos++ );
 			break;
 
@@ -173,12 +175,14 @@ blip_time_t Vgm_Emu_Impl::run_commands( vgm_time_t end_time )
 			break;
 
 		case cmd_ym2413:
+			count_apu_write();
 			if ( ym2413[0].run_until( to_fm_time( vgm_time ) ) )
 				ym2413[0].write( pos [0], pos [1] );
 			pos += 2;
 			break;
 
 		case cmd_ym2413_2:
+			count_apu_write();
 			if ( ym2413[1].run_until( to_fm_time( vgm_time ) ) )
 				ym2413[1].write( pos [0], pos [1] );
 			pos += 2;
@@ -196,12 +200,14 @@ blip_time_t Vgm_Emu_Impl::run_commands( vgm_time_t end_time )
 					dac_disabled = (pos [1] >> 7 & 1) - 1;
 					dac_amp |= dac_disabled;
 				}
+				count_apu_write();
 				ym2612[0].write0( pos [0], pos [1] );
 			}
 			pos += 2;
 			break;
 
 		case cmd_ym2612_port1:
+			count_apu_write();
 			if ( ym2612[0].run_until( to_fm_time( vgm_time ) ) )
 				ym2612[0].write1( pos [0], pos [1] );
 			pos += 2;
@@ -219,12 +225,14 @@ blip_time_t Vgm_Emu_Impl::run_commands( vgm_time_t end_time )
 					dac_disabled = (pos [1] >> 7 & 1) - 1;
 					dac_amp |= dac_disabled;
 				}
+				count_apu_write();
 				ym2612[1].write0( pos [0], pos [1] );
 			}
 			pos += 2;
 			break;
 
 		case cmd_ym2612_2_port1:
+			count_apu_write();
 			if ( ym2612[1].run_until( to_fm_time( vgm_time ) ) )
 				ym2612[1].write1( pos [0], pos [1] );
 			pos += 2;
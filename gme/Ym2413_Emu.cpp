@@ -1,21 +1,104 @@
-
-// Use in place of Ym2413_Emu.cpp and ym2413.c to disable support for this chip
-
 // Game_Music_Emu https://bitbucket.org/mpyne/game-music-emu/
 
 #include "Ym2413_Emu.h"
 
-Ym2413_Emu::Ym2413_Emu() { }
+#include "blargg_common.h"
+
+extern "C" {
+#include "ext/emu2413.h"
+}
+
+#include <algorithm>
+#include <math.h>
+
+#include "blargg_source.h"
+
+using std::min;
+
+Ym2413_Emu::Ym2413_Emu() { opll = 0; }
+
+Ym2413_Emu::~Ym2413_Emu()
+{
+	if ( opll )
+		OPLL_delete( (OPLL*) opll );
+}
+
+static bool init_tables()
+{
+	// first OPLL_new() builds the tables; later ones at the same clock and
+	// rate leave them alone
+	OPLL_delete( OPLL_new( Ym2413_Emu::opll_clock, Ym2413_Emu::opll_clock / 72 ) );
+	return true;
+}
+
+void* Ym2413_Emu::new_opll()
+{
+	static bool const tables_ready = init_tables();
+	(void) tables_ready;
+	return OPLL_new( opll_clock, opll_clock / 72 );
+}
+
+int Ym2413_Emu::set_rate( double sample_rate, double clock_rate )
+{
+	if ( opll )
+	{
+		OPLL_delete( (OPLL*) opll );
+		opll = 0;
+	}
+
+	assert( fabs( sample_rate * 72 - clock_rate ) < 72 );
+	(void) sample_rate;
+	(void) clock_rate;
+	opll = new_opll();
+	if ( !opll )
+		return 1;
 
-Ym2413_Emu::~Ym2413_Emu() { }
+	reset();
+	return 0;
+}
 
-int Ym2413_Emu::set_rate( double, double ) { return 2; }
+void Ym2413_Emu::reset()
+{
+	OPLL_reset( (OPLL*) opll );
+	OPLL_reset_patch( (OPLL*) opll, OPLL_2413_TONE );
+	OPLL_set_quality( (OPLL*) opll, 0 );
+}
 
-void Ym2413_Emu::reset() { }
+void Ym2413_Emu::write( int addr, int data )
+{
+	OPLL_writeIO( (OPLL*) opll, 0, addr );
+	OPLL_writeIO( (OPLL*) opll, 1, data );
+}
 
-void Ym2413_Emu::write( int, int ) { }
+void Ym2413_Emu::mute_voices( int mask )
+{
+	OPLL_SetMuteMask( (OPLL*) opll, mask );
+}
 
-void Ym2413_Emu::mute_voices( int ) { }
+void Ym2413_Emu::run( int pair_count, sample_t* out )
+{
+	// emu2413 renders a whole block per call, then it's mixed into out
+	e_int32 left  [block_size];
+	e_int32 right [block_size];
+	e_int32* bufs [2] = { left, right };
 
-void Ym2413_Emu::run( int, sample_t* ) { }
+	while ( pair_count > 0 )
+	{
+		int const count = min( pair_count, (int) block_size );
+		pair_count -= count;
+		OPLL_calc_stereo( (OPLL*) opll, bufs, count, -1 );
 
+		for ( int i = 0; i < count; i++ )
+		{
+			int l = out [0] + left  [i];
+			int r = out [1] + right [i];
+			if ( (int16_t) l != l )
+				l = 0x7FFF - (l >> 24);
+			if ( (int16_t) r != r )
+				r = 0x7FFF - (r >> 24);
+			out [0] = l;
+			out [1] = r;
+			out += 2;
+		}
+	}
+}
@@ -5,13 +5,15 @@
 #define YM2413_EMU_H
 
 class Ym2413_Emu  {
-	struct OPLL* opll;
+	void* opll;
+	enum { block_size = 256 }; // samples rendered per emu2413 call
 public:
 	Ym2413_Emu();
 	~Ym2413_Emu();
 
 	// Set output sample rate and chip clock rates, in Hz. Returns non-zero
-	// if error.
+	// if error. Output is always one sample per 72 chip clocks, so
+	// sample_rate must be clock_rate / 72; resample it for other rates.
 	int set_rate( double sample_rate, double clock_rate );
 
 	// Reset to power-up state
@@ -28,6 +30,13 @@ public:
 	typedef short sample_t;
 	enum { out_chan_count = 2 }; // stereo
 	void run( int pair_count, sample_t* out );
+
+	// Create an emu2413 OPLL, or return NULL if out of memory. emu2413's
+	// tables are global, so every OPLL (including VRC7's) is made here at
+	// the same clock, which keeps instances on other threads unaffected.
+	// Other clocks only change the rate the samples are played back at.
+	enum { opll_clock = 3579545 };
+	static void* new_opll();
 };
 
 #endif
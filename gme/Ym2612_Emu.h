@@ -12,6 +12,9 @@
 # endif
 #include "Ym2612_GENS.h"
 typedef Ym2612_GENS_Emu Ym2612_Emu;
+// True if running at a lower sample rate takes less time. The others always
+// clock the chip at its own rate.
+bool const ym2612_rate_saves_time = true;
 #endif
 
 #ifdef VGM_YM2612_NUKED // LGPL v2.1+ license
@@ -20,6 +23,7 @@ typedef Ym2612_GENS_Emu Ym2612_Emu;
 # endif
 #include "Ym2612_Nuked.h"
 typedef Ym2612_Nuked_Emu Ym2612_Emu;
+bool const ym2612_rate_saves_time = false;
 #endif
 
 #ifdef VGM_YM2612_MAME // GPL v2+ license
@@ -28,5 +32,6 @@ typedef Ym2612_Nuked_Emu Ym2612_Emu;
 # endif
 #include "Ym2612_MAME.h"
 typedef Ym2612_MAME_Emu Ym2612_Emu;
+bool const ym2612_rate_saves_time = false;
 #endif
 
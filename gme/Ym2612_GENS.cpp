@@ -6,6 +6,7 @@
 
 #include "Ym2612_GENS.h"
 #include "blargg_common.h"
+#include "blargg_simd.h"
 
 #include <assert.h>
 #include <stdlib.h>
@@ -194,18 +195,14 @@ inline void set_seg( slot_t& s, int seg )
 	}
 }
 
-struct tables_t
+// Tables that don't depend on the sample rate. These are built when the
+// library is loaded and are const from then on, so all instances share them.
+struct shared_tables_t
 {
+	shared_tables_t();
+
 	short SIN_TAB [SIN_LENGHT];                 // SINUS TABLE (offset into TL TABLE)
-	int LFOcnt;         // LFO counter = compteur-frequence pour le LFO
-	int LFOinc;         // LFO step counter = pas d'incrementation du compteur-frequence du LFO
-						// plus le pas est grand, plus la frequence est grande
-	unsigned int AR_TAB [128];                  // Attack rate table
-	unsigned int DR_TAB [96];                   // Decay rate table
-	unsigned int DT_TAB [8] [32];               // Detune table
 	unsigned int SL_TAB [16];                   // Substain level table
-	unsigned int NULL_RATE [32];                // Table for NULL rate
-	int LFO_INC_TAB [8];                        // LFO step table
 
 	short ENV_TAB [2 * ENV_LENGHT + 8];         // ENV CURVE TABLE (attack & decay)
 
@@ -213,6 +210,20 @@ struct tables_t
 	short LFO_FREQ_TAB [LFO_LENGHT];            // LFO FMS TABLE
 	int TL_TAB [TL_LENGHT * 2];                 // TOTAL LEVEL TABLE (positif and minus)
 	unsigned int DECAY_TO_ATTACK [ENV_LENGHT];  // Conversion from decay to attack phase
+};
+
+static shared_tables_t const tab;
+
+struct tables_t
+{
+	int LFOcnt;         // LFO counter = compteur-frequence pour le LFO
+	int LFOinc;         // LFO step counter = pas d'incrementation du compteur-frequence du LFO
+						// plus le pas est grand, plus la frequence est grande
+	unsigned int AR_TAB [128];                  // Attack rate table
+	unsigned int DR_TAB [96];                   // Decay rate table
+	unsigned int DT_TAB [8] [32];               // Detune table
+	unsigned int NULL_RATE [32];                // Table for NULL rate
+	int LFO_INC_TAB [8];                        // LFO step table
 	unsigned int FINC_TAB [2048];               // Frequency step table
 };
 
@@ -290,10 +301,10 @@ void Ym2612_GENS_Impl::KEY_ON( channel_t& ch, int nsl)
 
 		// Fix Ecco 2 splash sound
 
-		SL->Ecnt = (g.DECAY_TO_ATTACK [g.ENV_TAB [SL->Ecnt >> ENV_LBITS]] + ENV_ATTACK) & SL->ChgEnM;
+		SL->Ecnt = (tab.DECAY_TO_ATTACK [tab.ENV_TAB [SL->Ecnt >> ENV_LBITS]] + ENV_ATTACK) & SL->ChgEnM;
 		SL->ChgEnM = ~0;
 
-//      SL->Ecnt = g.DECAY_TO_ATTACK [g.ENV_TAB [SL->Ecnt >> ENV_LBITS]] + ENV_ATTACK;
+//      SL->Ecnt = tab.DECAY_TO_ATTACK [tab.ENV_TAB [SL->Ecnt >> ENV_LBITS]] + ENV_ATTACK;
 //      SL->Ecnt = 0;
 
 		SL->Einc = SL->EincA;
@@ -311,7 +322,7 @@ void Ym2612_GENS_Impl::KEY_OFF(channel_t& ch, int nsl)
 	{
 		if (SL->Ecnt < ENV_DECAY)   // attack phase ?
 		{
-			SL->Ecnt = (g.ENV_TAB [SL->Ecnt >> ENV_LBITS] << ENV_LBITS) + ENV_DECAY;
+			SL->Ecnt = (tab.ENV_TAB [SL->Ecnt >> ENV_LBITS] << ENV_LBITS) + ENV_DECAY;
 		}
 
 		SL->Einc = SL->EincR;
@@ -388,7 +399,7 @@ int Ym2612_GENS_Impl::SLOT_SET( int Adr, int data )
 			break;
 
 		case 0x80:
-			sl.SLL = g.SL_TAB [data >> 4];
+			sl.SLL = tab.SL_TAB [data >> 4];
 
 			sl.RR = (int*) &g.DR_TAB [((data & 0xF) << 2) + 2];
 
@@ -631,21 +642,10 @@ int Ym2612_GENS_Impl::YM_SET(int Adr, int data)
 	return 0;
 }
 
-void Ym2612_GENS_Impl::set_rate( double sample_rate, double clock_rate )
+shared_tables_t::shared_tables_t()
 {
-	assert( sample_rate );
-	assert( clock_rate > sample_rate );
-
 	int i;
 
-	// 144 = 12 * (prescale * 2) = 12 * 6 * 2
-	// prescale set to 6 by default
-
-	double Frequence = clock_rate / sample_rate / 144.0;
-	if ( fabs( Frequence - 1.0 ) < 0.0000001 )
-		Frequence = 1.0;
-	YM2612.TimerBase = int (Frequence * 4096.0);
-
 	// Tableau TL :
 	// [0     -  4095] = +output  [4095  - ...] = +output overflow (fill with 0)
 	// [12288 - 16383] = -output  [16384 - ...] = -output overflow (fill with 0)
@@ -654,23 +654,23 @@ void Ym2612_GENS_Impl::set_rate( double sample_rate, double clock_rate )
 	{
 		if (i >= PG_CUT_OFF)    // YM2612 cut off sound after 78 dB (14 bits output ?)
 		{
-			g.TL_TAB [TL_LENGHT + i] = g.TL_TAB [i] = 0;
+			TL_TAB [TL_LENGHT + i] = TL_TAB [i] = 0;
 		}
 		else
 		{
 			double x = MAX_OUT;                         // Max output
 			x /= pow( 10.0, (ENV_STEP * i) / 20.0 );    // Decibel -> Voltage
 
-			g.TL_TAB [i] = (int) x;
-			g.TL_TAB [TL_LENGHT + i] = -g.TL_TAB [i];
+			TL_TAB [i] = (int) x;
+			TL_TAB [TL_LENGHT + i] = -TL_TAB [i];
 		}
 	}
 
 	// Tableau SIN :
-	// g.SIN_TAB [x] [y] = sin(x) * y;
+	// SIN_TAB [x] [y] = sin(x) * y;
 	// x = phase and y = volume
 
-	g.SIN_TAB [0] = g.SIN_TAB [SIN_LENGHT / 2] = PG_CUT_OFF;
+	SIN_TAB [0] = SIN_TAB [SIN_LENGHT / 2] = PG_CUT_OFF;
 
 	for(i = 1; i <= SIN_LENGHT / 4; i++)
 	{
@@ -681,8 +681,8 @@ void Ym2612_GENS_Impl::set_rate( double sample_rate, double clock_rate )
 
 		if (j > PG_CUT_OFF) j = (int) PG_CUT_OFF;
 
-		g.SIN_TAB [i] = g.SIN_TAB [(SIN_LENGHT / 2) - i] = j;
-		g.SIN_TAB [(SIN_LENGHT / 2) + i] = g.SIN_TAB [SIN_LENGHT - i] = TL_LENGHT + j;
+		SIN_TAB [i] = SIN_TAB [(SIN_LENGHT / 2) - i] = j;
+		SIN_TAB [(SIN_LENGHT / 2) + i] = SIN_TAB [SIN_LENGHT - i] = TL_LENGHT + j;
 	}
 
 	// Tableau LFO (LFO wav) :
@@ -694,18 +694,18 @@ void Ym2612_GENS_Impl::set_rate( double sample_rate, double clock_rate )
 		x /= 2.0;                   // positive only
 		x *= 11.8 / ENV_STEP;       // ajusted to MAX enveloppe modulation
 
-		g.LFO_ENV_TAB [i] = (int) x;
+		LFO_ENV_TAB [i] = (int) x;
 
 		x = sin(2.0 * PI * (double) (i) / (double) (LFO_LENGHT));   // Sinus
 		x *= (double) ((1 << (LFO_HBITS - 1)) - 1);
 
-		g.LFO_FREQ_TAB [i] = (int) x;
+		LFO_FREQ_TAB [i] = (int) x;
 
 	}
 
 	// Tableau Enveloppe :
-	// g.ENV_TAB [0] -> g.ENV_TAB [ENV_LENGHT - 1]              = attack curve
-	// g.ENV_TAB [ENV_LENGHT] -> g.ENV_TAB [2 * ENV_LENGHT - 1] = decay curve
+	// ENV_TAB [0] -> ENV_TAB [ENV_LENGHT - 1]              = attack curve
+	// ENV_TAB [ENV_LENGHT] -> ENV_TAB [2 * ENV_LENGHT - 1] = decay curve
 
 	for(i = 0; i < ENV_LENGHT; i++)
 	{
@@ -713,28 +713,28 @@ void Ym2612_GENS_Impl::set_rate( double sample_rate, double clock_rate )
 		double x = pow(((double) ((ENV_LENGHT - 1) - i) / (double) (ENV_LENGHT)), 8);
 		x *= ENV_LENGHT;
 
-		g.ENV_TAB [i] = (int) x;
+		ENV_TAB [i] = (int) x;
 
 		// Decay curve (just linear)
 		x = pow(((double) (i) / (double) (ENV_LENGHT)), 1);
 		x *= ENV_LENGHT;
 
-		g.ENV_TAB [ENV_LENGHT + i] = (int) x;
+		ENV_TAB [ENV_LENGHT + i] = (int) x;
 	}
 	for ( i = 0; i < 8; i++ )
-		g.ENV_TAB [i + ENV_LENGHT * 2] = 0;
+		ENV_TAB [i + ENV_LENGHT * 2] = 0;
 
-	g.ENV_TAB [ENV_END >> ENV_LBITS] = ENV_LENGHT - 1;      // for the stopped state
+	ENV_TAB [ENV_END >> ENV_LBITS] = ENV_LENGHT - 1;      // for the stopped state
 
 	// Tableau pour la conversion Attack -> Decay and Decay -> Attack
 
 	int j = ENV_LENGHT - 1;
 	for ( i = 0; i < ENV_LENGHT; i++ )
 	{
-		while ( j && g.ENV_TAB [j] < i )
+		while ( j && ENV_TAB [j] < i )
 			j--;
 
-		g.DECAY_TO_ATTACK [i] = j << ENV_LBITS;
+		DECAY_TO_ATTACK [i] = j << ENV_LBITS;
 	}
 
 	// Tableau pour le Substain Level
@@ -744,10 +744,26 @@ void Ym2612_GENS_Impl::set_rate( double sample_rate, double clock_rate )
 		double x = i * 3;           // 3 and not 6 (Mickey Mania first music for test)
 		x /= ENV_STEP;
 
-		g.SL_TAB [i] = ((int) x << ENV_LBITS) + ENV_DECAY;
+		SL_TAB [i] = ((int) x << ENV_LBITS) + ENV_DECAY;
 	}
 
-	g.SL_TAB [15] = ((ENV_LENGHT - 1) << ENV_LBITS) + ENV_DECAY; // special case : volume off
+	SL_TAB [15] = ((ENV_LENGHT - 1) << ENV_LBITS) + ENV_DECAY; // special case : volume off
+}
+
+void Ym2612_GENS_Impl::set_rate( double sample_rate, double clock_rate )
+{
+	assert( sample_rate );
+	assert( clock_rate > sample_rate );
+
+	int i;
+
+	// 144 = 12 * (prescale * 2) = 12 * 6 * 2
+	// prescale set to 6 by default
+
+	double Frequence = clock_rate / sample_rate / 144.0;
+	if ( fabs( Frequence - 1.0 ) < 0.0000001 )
+		Frequence = 1.0;
+	YM2612.TimerBase = int (Frequence * 4096.0);
 
 	// Tableau Frequency Step
 
@@ -780,7 +796,7 @@ void Ym2612_GENS_Impl::set_rate( double sample_rate, double clock_rate )
 
 		x *= 1.0 + ((i & 3) * 0.25);                    // bits 0-1 : x1.00, x1.25, x1.50, x1.75
 		x *= (double) (1 << ((i >> 2)));                // bits 2-5 : shift bits (x2^0 - x2^15)
-		x *= (double) (ENV_LENGHT << ENV_LBITS);        // on ajuste pour le tableau g.ENV_TAB
+		x *= (double) (ENV_LENGHT << ENV_LBITS);        // on ajuste pour le tableau tab.ENV_TAB
 
 		g.AR_TAB [i + 4] = (unsigned int) (x / AR_RATE);
 		g.DR_TAB [i + 4] = (unsigned int) (x / DR_RATE);
@@ -1076,9 +1092,9 @@ void ym2612_update_chan<algo>::func( tables_t& g, channel_t& ch,
 	do
 	{
 		// envelope
-		int const env_LFO = g.LFO_ENV_TAB [YM2612_LFOcnt >> LFO_LBITS & LFO_MASK];
+		int const env_LFO = tab.LFO_ENV_TAB [YM2612_LFOcnt >> LFO_LBITS & LFO_MASK];
 
-		short const* const ENV_TAB = g.ENV_TAB;
+		short const* const ENV_TAB = tab.ENV_TAB;
 
 	#define CALC_EN( x ) \
 		int temp##x = ENV_TAB [ch.SLOT [S##x].Ecnt >> ENV_LBITS] + ch.SLOT [S##x].TLL;  \
@@ -1090,9 +1106,9 @@ void ym2612_update_chan<algo>::func( tables_t& g, channel_t& ch,
 		CALC_EN( 2 )
 		CALC_EN( 3 )
 
-		int const* const TL_TAB = g.TL_TAB;
+		int const* const TL_TAB = tab.TL_TAB;
 
-	#define SINT( i, o ) (TL_TAB [g.SIN_TAB [(i)] + (o)])
+	#define SINT( i, o ) (TL_TAB [tab.SIN_TAB [(i)] + (o)])
 
 		// feedback
 		int CH_S0_OUT_0 = ch.S0_OUT [0];
@@ -1162,7 +1178,7 @@ void ym2612_update_chan<algo>::func( tables_t& g, channel_t& ch,
 		CH_OUTd >>= MAX_OUT_BITS - output_bits + 2;
 
 		// update phase
-		unsigned freq_LFO = ((g.LFO_FREQ_TAB [YM2612_LFOcnt >> LFO_LBITS & LFO_MASK] *
+		unsigned freq_LFO = ((tab.LFO_FREQ_TAB [YM2612_LFOcnt >> LFO_LBITS & LFO_MASK] *
 				ch.FMS) >> (LFO_HBITS - 1 + 1)) + (1L << (LFO_FMS_LBITS - 1));
 		YM2612_LFOcnt += YM2612_LFOinc;
 		in0 += (ch.SLOT [S0].Finc * freq_LFO) >> (LFO_FMS_LBITS - 1);
@@ -1204,6 +1220,380 @@ static const ym2612_update_chan_t UPDATE_CHAN [8] = {
 	&ym2612_update_chan<7>::func
 };
 
+#if BLARGG_SIMD_AVX2
+
+// Returns false if ym2612_update_chan would return immediately without doing anything
+static bool chan_playing( channel_t const& ch )
+{
+	int not_end = ch.SLOT [S3].Ecnt - ENV_END;
+	if ( ch.ALGO == 7 )
+		not_end |= ch.SLOT [S0].Ecnt - ENV_END;
+	if ( ch.ALGO >= 5 )
+		not_end |= ch.SLOT [S2].Ecnt - ENV_END;
+	if ( ch.ALGO >= 4 )
+		not_end |= ch.SLOT [S1].Ecnt - ENV_END;
+	return not_end != 0;
+}
+
+// Channel-parallel version of ym2612_update_chan: each 32-bit lane runs one
+// channel through the same arithmetic and table lookups as the scalar code.
+// The per-algorithm operator connections become masks, so every lane can use
+// a different algorithm. Outputs wrap to 16 bits just like the scalar version,
+// so adding all channels at once gives the same buffer contents.
+
+// Operator connection masks, indexed by algorithm. Columns are
+// S1<-S0, S2<-S0, S2<-S1, S3<-S0, S3<-S1, S3<-S2, out<-S1, out<-S2, out<-S0
+static const signed char algo_conn [8] [9] =
+{
+	{ 1, 0, 1, 0, 0, 1, 0, 0, 0 },
+	{ 0, 1, 1, 0, 0, 1, 0, 0, 0 },
+	{ 0, 0, 1, 1, 0, 1, 0, 0, 0 },
+	{ 1, 0, 0, 0, 1, 1, 0, 0, 0 },
+	{ 1, 0, 0, 0, 0, 1, 1, 0, 0 },
+	{ 1, 1, 0, 1, 0, 0, 1, 1, 0 },
+	{ 1, 0, 0, 0, 0, 0, 1, 1, 0 },
+	{ 0, 0, 0, 0, 0, 0, 1, 1, 1 }
+};
+
+struct chan_lanes_t
+{
+	enum { size = 8 };
+	slot_t* slot [4] [size]; // in S0-S3 order
+	int Fcnt [4] [size];
+	int Finc [4] [size];
+	int Ecnt [4] [size];
+	int Einc [4] [size];
+	int Ecmp [4] [size];
+	int TLL [4] [size];
+	int env_xor [4] [size];
+	int env_max [4] [size];
+	int AMS [4] [size];
+	int conn [9] [size];
+	int FB [size];
+	int FMS [size];
+	int LEFT [size];
+	int RIGHT [size];
+	int S0_OUT0 [size];
+	int S0_OUT1 [size];
+};
+
+static void load_lanes( chan_lanes_t& l, channel_t* const* chans, int count )
+{
+	static unsigned char const op_slot [4] = { S0, S1, S2, S3 };
+	blarg_memset( &l, 0, sizeof l );
+	for ( int i = 0; i < chan_lanes_t::size; i++ )
+	{
+		if ( i >= count )
+		{
+			// unused lane: stays silent and never reaches an envelope transition
+			for ( int op = 0; op < 4; op++ )
+			{
+				l.Ecnt [op] [i] = ENV_END;
+				l.Ecmp [op] [i] = INT_MAX;
+				l.env_max [op] [i] = INT_MAX;
+				l.AMS [op] [i] = 31;
+			}
+			l.FB [i] = 31;
+			continue;
+		}
+
+		channel_t& ch = *chans [i];
+		for ( int op = 0; op < 4; op++ )
+		{
+			slot_t& sl = ch.SLOT [op_slot [op]];
+			l.slot    [op] [i] = &sl;
+			l.Fcnt    [op] [i] = sl.Fcnt;
+			l.Finc    [op] [i] = sl.Finc;
+			l.Ecnt    [op] [i] = sl.Ecnt;
+			l.Einc    [op] [i] = sl.Einc;
+			l.Ecmp    [op] [i] = sl.Ecmp;
+			l.TLL     [op] [i] = sl.TLL;
+			l.env_xor [op] [i] = sl.env_xor;
+			l.env_max [op] [i] = sl.env_max;
+			l.AMS     [op] [i] = sl.AMS;
+		}
+		for ( int c = 0; c < 9; c++ )
+			l.conn [c] [i] = -algo_conn [ch.ALGO] [c];
+		l.FB      [i] = ch.FB;
+		l.FMS     [i] = ch.FMS;
+		l.LEFT    [i] = ch.LEFT;
+		l.RIGHT   [i] = ch.RIGHT;
+		l.S0_OUT0 [i] = ch.S0_OUT [0];
+		l.S0_OUT1 [i] = ch.S0_OUT [1];
+	}
+}
+
+static void store_lanes( chan_lanes_t const& l, channel_t* const* chans, int count )
+{
+	for ( int i = 0; i < count; i++ )
+	{
+		for ( int op = 0; op < 4; op++ )
+		{
+			l.slot [op] [i]->Fcnt = l.Fcnt [op] [i];
+			l.slot [op] [i]->Ecnt = l.Ecnt [op] [i];
+		}
+		chans [i]->S0_OUT [0] = l.S0_OUT0 [i];
+		chans [i]->S0_OUT [1] = l.S0_OUT1 [i];
+	}
+}
+
+// Runs update_envelope_() on lanes whose envelope counter reached its limit
+// and reloads the envelope state it changed
+static void update_lane_envelopes( chan_lanes_t& l, int op, int lanes )
+{
+	for ( int i = 0; i < chan_lanes_t::size; i++ )
+	{
+		if ( !(lanes >> i & 1) )
+			continue;
+
+		slot_t& sl = *l.slot [op] [i];
+		sl.Ecnt = l.Ecnt [op] [i];
+		update_envelope_( &sl );
+		l.Ecnt    [op] [i] = sl.Ecnt;
+		l.Einc    [op] [i] = sl.Einc;
+		l.Ecmp    [op] [i] = sl.Ecmp;
+		l.env_xor [op] [i] = sl.env_xor;
+		l.env_max [op] [i] = sl.env_max;
+	}
+}
+
+// Lane operations for 8 channels (__m256i) or 4 channels (__m128i). Narrower
+// gathers are cheaper, so the four-lane form is used when few channels play.
+struct avx2_lanes8
+{
+	typedef __m256i v;
+	enum { size = 8 };
+	BLARGG_TARGET_AVX2 static v load( int const* p )   { return _mm256_loadu_si256( (__m256i const*) p ); }
+	BLARGG_TARGET_AVX2 static void store( int* p, v x ) { _mm256_storeu_si256( (__m256i*) p, x ); }
+	BLARGG_TARGET_AVX2 static v set1( int n )          { return _mm256_set1_epi32( n ); }
+	BLARGG_TARGET_AVX2 static v add( v x, v y )        { return _mm256_add_epi32( x, y ); }
+	BLARGG_TARGET_AVX2 static v sub( v x, v y )        { return _mm256_sub_epi32( x, y ); }
+	BLARGG_TARGET_AVX2 static v and_( v x, v y )       { return _mm256_and_si256( x, y ); }
+	BLARGG_TARGET_AVX2 static v xor_( v x, v y )       { return _mm256_xor_si256( x, y ); }
+	BLARGG_TARGET_AVX2 static v mul( v x, v y )        { return _mm256_mullo_epi32( x, y ); }
+	BLARGG_TARGET_AVX2 static v min( v x, v y )        { return _mm256_min_epi32( x, y ); }
+	BLARGG_TARGET_AVX2 static v sra( v x, int n )      { return _mm256_sra_epi32( x, _mm_cvtsi32_si128( n ) ); }
+	BLARGG_TARGET_AVX2 static v srl( v x, int n )      { return _mm256_srl_epi32( x, _mm_cvtsi32_si128( n ) ); }
+	BLARGG_TARGET_AVX2 static v sll( v x, int n )      { return _mm256_sll_epi32( x, _mm_cvtsi32_si128( n ) ); }
+	BLARGG_TARGET_AVX2 static v srav( v x, v n )       { return _mm256_srav_epi32( x, n ); }
+	BLARGG_TARGET_AVX2 static v srlv( v x, v n )       { return _mm256_srlv_epi32( x, n ); }
+	BLARGG_TARGET_AVX2 static v gt( v x, v y )         { return _mm256_cmpgt_epi32( x, y ); }
+	BLARGG_TARGET_AVX2 static int mask( v x )          { return _mm256_movemask_ps( _mm256_castsi256_ps( x ) ); }
+	BLARGG_TARGET_AVX2 static v gather( int const* t, v i ) { return _mm256_i32gather_epi32( t, i, 4 ); }
+	BLARGG_TARGET_AVX2 static v gather_short( short const* t, v i )
+	{
+		return _mm256_i32gather_epi32( (int const*) t, i, 2 );
+	}
+	// sum of all x lanes in low int, sum of all y lanes in next int
+	BLARGG_TARGET_AVX2 static __m128i sum2( v x, v y )
+	{
+		v s = _mm256_hadd_epi32( x, y );
+		s = _mm256_hadd_epi32( s, s );
+		return _mm_add_epi32( _mm256_castsi256_si128( s ), _mm256_extracti128_si256( s, 1 ) );
+	}
+};
+
+struct avx2_lanes4
+{
+	typedef __m128i v;
+	enum { size = 4 };
+	BLARGG_TARGET_AVX2 static v load( int const* p )   { return _mm_loadu_si128( (__m128i const*) p ); }
+	BLARGG_TARGET_AVX2 static void store( int* p, v x ) { _mm_storeu_si128( (__m128i*) p, x ); }
+	BLARGG_TARGET_AVX2 static v set1( int n )          { return _mm_set1_epi32( n ); }
+	BLARGG_TARGET_AVX2 static v add( v x, v y )        { return _mm_add_epi32( x, y ); }
+	BLARGG_TARGET_AVX2 static v sub( v x, v y )        { return _mm_sub_epi32( x, y ); }
+	BLARGG_TARGET_AVX2 static v and_( v x, v y )       { return _mm_and_si128( x, y ); }
+	BLARGG_TARGET_AVX2 static v xor_( v x, v y )       { return _mm_xor_si128( x, y ); }
+	BLARGG_TARGET_AVX2 static v mul( v x, v y )        { return _mm_mullo_epi32( x, y ); }
+	BLARGG_TARGET_AVX2 static v min( v x, v y )        { return _mm_min_epi32( x, y ); }
+	BLARGG_TARGET_AVX2 static v sra( v x, int n )      { return _mm_sra_epi32( x, _mm_cvtsi32_si128( n ) ); }
+	BLARGG_TARGET_AVX2 static v srl( v x, int n )      { return _mm_srl_epi32( x, _mm_cvtsi32_si128( n ) ); }
+	BLARGG_TARGET_AVX2 static v sll( v x, int n )      { return _mm_sll_epi32( x, _mm_cvtsi32_si128( n ) ); }
+	BLARGG_TARGET_AVX2 static v srav( v x, v n )       { return _mm_srav_epi32( x, n ); }
+	BLARGG_TARGET_AVX2 static v srlv( v x, v n )       { return _mm_srlv_epi32( x, n ); }
+	BLARGG_TARGET_AVX2 static v gt( v x, v y )         { return _mm_cmpgt_epi32( x, y ); }
+	BLARGG_TARGET_AVX2 static int mask( v x )          { return _mm_movemask_ps( _mm_castsi128_ps( x ) ); }
+	BLARGG_TARGET_AVX2 static v gather( int const* t, v i ) { return _mm_i32gather_epi32( t, i, 4 ); }
+	BLARGG_TARGET_AVX2 static v gather_short( short const* t, v i )
+	{
+		return _mm_i32gather_epi32( (int const*) t, i, 2 );
+	}
+	BLARGG_TARGET_AVX2 static __m128i sum2( v x, v y )
+	{
+		v s = _mm_hadd_epi32( x, y );
+		return _mm_hadd_epi32( s, s );
+	}
+};
+
+// SINT( (phase >> SIN_LBITS) & SIN_MASK, en )
+template<class V>
+BLARGG_TARGET_AVX2 static inline typename V::v sint_lanes( typename V::v phase, typename V::v en )
+{
+	typename V::v i = V::and_( V::srl( phase, SIN_LBITS ), V::set1( SIN_MASK ) );
+	// fetches two shorts per lane; SIN_TAB and ENV_TAB are followed by other
+	// members, so the extra one never reads outside shared_tables_t
+	i = V::add( V::sra( V::sll( V::gather_short( tab.SIN_TAB, i ), 16 ), 16 ), en );
+	return V::gather( tab.TL_TAB, i );
+}
+
+template<class V>
+BLARGG_TARGET_AVX2 static void update_chans_avx2( tables_t& g, channel_t* const* chans,
+		int count, Ym2612_GENS_Emu::sample_t* buf, int length )
+{
+	typedef typename V::v v;
+
+	chan_lanes_t l;
+	load_lanes( l, chans, count );
+	int const active = (1 << count) - 1;
+
+	v in [4], Ecnt [4], Einc [4], Ecmp [4], TLL [4], env_xor [4], env_max [4], AMS [4], Finc [4];
+	for ( int op = 0; op < 4; op++ )
+	{
+		in      [op] = V::load( l.Fcnt    [op] );
+		Finc    [op] = V::load( l.Finc    [op] );
+		Ecnt    [op] = V::load( l.Ecnt    [op] );
+		Einc    [op] = V::load( l.Einc    [op] );
+		Ecmp    [op] = V::load( l.Ecmp    [op] );
+		TLL     [op] = V::load( l.TLL     [op] );
+		env_xor [op] = V::load( l.env_xor [op] );
+		env_max [op] = V::load( l.env_max [op] );
+		AMS     [op] = V::load( l.AMS     [op] );
+	}
+	v conn [9];
+	for ( int c = 0; c < 9; c++ )
+		conn [c] = V::load( l.conn [c] );
+	v const FB    = V::load( l.FB );
+	v const FMS   = V::load( l.FMS );
+	v const LEFT  = V::load( l.LEFT );
+	v const RIGHT = V::load( l.RIGHT );
+	v S0_OUT0 = V::load( l.S0_OUT0 );
+	v S0_OUT1 = V::load( l.S0_OUT1 );
+
+	int YM2612_LFOinc = g.LFOinc;
+	int YM2612_LFOcnt = g.LFOcnt + YM2612_LFOinc;
+
+	// With LFO stopped, its modulation and the phase steps stay the same
+	v env_LFO_AMS [4], Fstep [4];
+	if ( !YM2612_LFOinc )
+	{
+		v const env_LFO = V::set1( tab.LFO_ENV_TAB [YM2612_LFOcnt >> LFO_LBITS & LFO_MASK] );
+		v const freq_LFO = V::add( V::set1( 1 << (LFO_FMS_LBITS - 1) ), V::sra( V::mul( FMS,
+				V::set1( tab.LFO_FREQ_TAB [YM2612_LFOcnt >> LFO_LBITS & LFO_MASK] ) ), LFO_HBITS - 1 + 1 ) );
+		for ( int op = 0; op < 4; op++ )
+		{
+			env_LFO_AMS [op] = V::srlv( env_LFO, AMS [op] );
+			Fstep [op] = V::srl( V::mul( Finc [op], freq_LFO ), LFO_FMS_LBITS - 1 );
+		}
+	}
+
+	do
+	{
+		// envelope
+		if ( YM2612_LFOinc )
+		{
+			v const env_LFO = V::set1( tab.LFO_ENV_TAB [YM2612_LFOcnt >> LFO_LBITS & LFO_MASK] );
+			for ( int op = 0; op < 4; op++ )
+				env_LFO_AMS [op] = V::srlv( env_LFO, AMS [op] );
+		}
+
+		v env [4];
+		v const env_min = V::min( V::min( Ecnt [0], Ecnt [1] ), V::min( Ecnt [2], Ecnt [3] ) );
+		if ( V::mask( V::gt( V::set1( ENV_DECAY ), env_min ) ) )
+		{
+			for ( int op = 0; op < 4; op++ )
+			{
+				v const e = V::gather_short( tab.ENV_TAB, V::sra( Ecnt [op], ENV_LBITS ) );
+				env [op] = V::sra( V::sll( e, 16 ), 16 );
+			}
+		}
+		else
+		{
+			// past attack phase ENV_TAB is linear, ending with ENV_LENGHT - 1
+			for ( int op = 0; op < 4; op++ )
+				env [op] = V::min( V::sub( V::sra( Ecnt [op], ENV_LBITS ), V::set1( ENV_LENGHT ) ),
+						V::set1( ENV_LENGHT - 1 ) );
+		}
+
+		v en [4];
+		for ( int op = 0; op < 4; op++ )
+		{
+			v const temp = V::add( env [op], TLL [op] );
+			en [op] = V::and_( V::add( V::xor_( temp, env_xor [op] ), env_LFO_AMS [op] ),
+					V::sra( V::sub( temp, env_max [op] ), 31 ) );
+		}
+
+		// feedback
+		v const temp = V::add( in [0], V::srav( V::add( S0_OUT0, S0_OUT1 ), FB ) );
+		S0_OUT1 = S0_OUT0;
+		S0_OUT0 = sint_lanes<V>( temp, en [0] );
+
+		// operators, connected according to each lane's algorithm
+		v const fb = S0_OUT1;
+		v const o1 = sint_lanes<V>( V::add( in [1], V::and_( fb, conn [0] ) ), en [1] );
+		v const o2 = sint_lanes<V>( V::add( V::add( in [2], V::and_( fb, conn [1] ) ),
+				V::and_( o1, conn [2] ) ), en [2] );
+		v const o3 = sint_lanes<V>( V::add( V::add( in [3], V::and_( fb, conn [3] ) ),
+				V::add( V::and_( o1, conn [4] ), V::and_( o2, conn [5] ) ) ), en [3] );
+		v CH_OUTd = V::add( V::add( o3, V::and_( fb, conn [8] ) ),
+				V::add( V::and_( o1, conn [6] ), V::and_( o2, conn [7] ) ) );
+		CH_OUTd = V::sra( CH_OUTd, MAX_OUT_BITS - output_bits + 2 );
+
+		// update phase
+		if ( YM2612_LFOinc )
+		{
+			v const freq_LFO = V::add( V::set1( 1 << (LFO_FMS_LBITS - 1) ), V::sra( V::mul( FMS,
+					V::set1( tab.LFO_FREQ_TAB [YM2612_LFOcnt >> LFO_LBITS & LFO_MASK] ) ), LFO_HBITS - 1 + 1 ) );
+			YM2612_LFOcnt += YM2612_LFOinc;
+			for ( int op = 0; op < 4; op++ )
+				Fstep [op] = V::srl( V::mul( Finc [op], freq_LFO ), LFO_FMS_LBITS - 1 );
+		}
+		for ( int op = 0; op < 4; op++ )
+			in [op] = V::add( in [op], Fstep [op] );
+
+		// mix all channels at once
+		__m128i const lr = V::sum2( V::and_( CH_OUTd, LEFT ), V::and_( CH_OUTd, RIGHT ) );
+		buf [0] += _mm_cvtsi128_si32( lr );
+		buf [1] += _mm_cvtsi128_si32( _mm_srli_si128( lr, 4 ) );
+		buf += 2;
+
+		// envelope counters, with transitions handled by update_envelope_()
+		v waiting = V::set1( -1 );
+		for ( int op = 0; op < 4; op++ )
+		{
+			Ecnt [op] = V::add( Ecnt [op], Einc [op] );
+			waiting = V::and_( waiting, V::gt( Ecmp [op], Ecnt [op] ) );
+		}
+		if ( ~V::mask( waiting ) & active )
+		{
+			for ( int op = 0; op < 4; op++ )
+			{
+				int const ended = ~V::mask( V::gt( Ecmp [op], Ecnt [op] ) ) & active;
+				if ( !ended )
+					continue;
+				V::store( l.Ecnt [op], Ecnt [op] );
+				update_lane_envelopes( l, op, ended );
+				Ecnt    [op] = V::load( l.Ecnt    [op] );
+				Einc    [op] = V::load( l.Einc    [op] );
+				Ecmp    [op] = V::load( l.Ecmp    [op] );
+				env_xor [op] = V::load( l.env_xor [op] );
+				env_max [op] = V::load( l.env_max [op] );
+			}
+		}
+	}
+	while ( --length );
+
+	for ( int op = 0; op < 4; op++ )
+	{
+		V::store( l.Fcnt [op], in   [op] );
+		V::store( l.Ecnt [op], Ecnt [op] );
+	}
+	V::store( l.S0_OUT0, S0_OUT0 );
+	V::store( l.S0_OUT1, S0_OUT1 );
+	store_lanes( l, chans, count );
+}
+
+#endif // BLARGG_SIMD_AVX2
+
 void Ym2612_GENS_Impl::run_timer( int length )
 {
 	int const step = 6;
@@ -1310,6 +1700,28 @@ void Ym2612_GENS_Impl::run( int pair_count, Ym2612_GENS_Emu::sample_t* out )
 		}
 	}
 
+#if BLARGG_SIMD_AVX2
+	if ( blargg_simd_level() >= blargg_simd_avx2 )
+	{
+		channel_t* playing [channel_count];
+		int playing_count = 0;
+		for ( int i = 0; i < channel_count; i++ )
+		{
+			if ( !(mute_mask & (1 << i)) && (i != 5 || !YM2612.DAC) &&
+					chan_playing( YM2612.CHANNEL [i] ) )
+				playing [playing_count++] = &YM2612.CHANNEL [i];
+		}
+
+		if ( playing_count > 4 )
+			update_chans_avx2<avx2_lanes8>( g, playing, playing_count, out, pair_count );
+		else if ( playing_count > 2 )
+			update_chans_avx2<avx2_lanes4>( g, playing, playing_count, out, pair_count );
+		else // lane setup costs more than it saves for one or two channels
+			for ( int i = 0; i < playing_count; i++ )
+				UPDATE_CHAN [playing [i]->ALGO]( g, *playing [i], out, pair_count );
+	}
+	else
+#endif
 	for ( int i = 0; i < channel_count; i++ )
 	{
 		if ( !(mute_mask & (1 << i)) && (i != 5 || !YM2612.DAC) )
@@ -5,6 +5,7 @@
 #ifdef VGM_YM2612_MAME
 
 #include "Ym2612_MAME.h"
+#include "blargg_common.h"
 
 /*
 **
@@ -2380,8 +2381,8 @@ static void reset_channels( FM_ST *ST , FM_CH *CH , int num )
 	}
 }
 
-/* initialize generic tables */
-static void init_tables(void)
+/* build generic tables */
+static bool build_tables(void)
 {
 	signed int i,x;
 	signed int n;
@@ -2482,6 +2483,16 @@ static void init_tables(void)
 #ifdef SAVE_SAMPLE
 	sample[0]=fopen("sampsum.pcm","wb");
 #endif
+
+	return true;
+}
+
+/* initialize generic tables; they are the same for every chip and only read
+   afterwards, so they are built once and shared by all instances */
+static void init_tables(void)
+{
+	static const bool tables_built = build_tables();
+	(void)tables_built;
 }
 
 #endif /* BUILD_OPN */
@@ -5,6 +5,7 @@
 #ifdef VGM_YM2612_NUKED
 
 #include "Ym2612_Nuked.h"
+#include "blargg_common.h"
 
 /*
  * Copyright (C) 2017 Alexey Khokholov (Nuke.YKT)
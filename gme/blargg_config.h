@@ -25,6 +25,10 @@
 // Uncomment to enable platform-specific optimizations
 //#define BLARGG_NONPORTABLE 1
 
+// Uncomment to use only portable code instead of SSE2/AVX2, or to stop at SSE2
+//#define BLARGG_DISABLE_SIMD 1
+//#define BLARGG_DISABLE_AVX2 1
+
 // Uncomment to use faster, lower quality sound synthesis
 //#define BLIP_BUFFER_FAST 1
 
@@ -39,7 +43,7 @@
 
 #if defined(_MSC_VER) && _MSC_VER <= 1200 /* 6 <= */
 #else
-	#if !defined(VGM_YM2612_GENS)
+	#if !defined(VGM_YM2612_GENS) && !defined(VGM_YM2612_NUKED) && !defined(VGM_YM2612_MAME)
 		#define VGM_YM2612_GENS
 	#endif
 #endif
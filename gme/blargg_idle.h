@@ -0,0 +1,39 @@
+// Idle loop skipping shared by the CPU cores
+
+#ifndef BLARGG_IDLE_H
+#define BLARGG_IDLE_H
+
+#include "blargg_common.h"
+
+// Loop that only uses time until end of time slice. Skips as many whole
+// iterations as complete before end, so the rest run exactly as before.
+// Expects the core's s_time (negative while time remains) and the CPU's
+// skipped_clocks_ to be in scope.
+#define SKIP_IDLE_LOOP( period ) {\
+	if ( s_time < 0 )\
+	{\
+		int32_t idle_count = -s_time / (period);\
+		s_time += idle_count * (period);\
+		skipped_clocks_ += idle_count * (period);\
+	}\
+}
+
+// 6502 family: loads and compares from zero page, the only instructions that
+// idle loops are recognized as polling. Zero page can't change until run()
+// returns.
+static inline bool is_zp_read( int opcode )
+{
+	switch ( opcode )
+	{
+	case 0xA5: // LDA zp
+	case 0xA6: // LDX zp
+	case 0xA4: // LDY zp
+	case 0xC5: // CMP zp
+	case 0xE4: // CPX zp
+	case 0xC4: // CPY zp
+		return true;
+	}
+	return false;
+}
+
+#endif
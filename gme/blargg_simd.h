@@ -0,0 +1,97 @@
+// SIMD instruction set detection
+
+#ifndef BLARGG_SIMD_H
+#define BLARGG_SIMD_H
+
+#include "blargg_common.h"
+
+// BLARGG_SIMD_SSE2: Defined if SSE2 intrinsics can be used unconditionally
+// (always the case for x86-64).
+// BLARGG_SIMD_AVX2: Defined if AVX2 code can be compiled into functions marked
+// with BLARGG_TARGET_AVX2. Such functions may only be called after checking
+// blargg_simd_level() at run time.
+// #define BLARGG_DISABLE_SIMD in blargg_config.h to use only portable code, or
+// BLARGG_DISABLE_AVX2 to stop at SSE2.
+#ifndef BLARGG_DISABLE_SIMD
+	#if defined (__SSE2__) || defined (_M_X64) || defined (_M_AMD64) || \
+			(defined (_M_IX86_FP) && _M_IX86_FP >= 2)
+		#define BLARGG_SIMD_SSE2 1
+		#include <emmintrin.h>
+
+		#if !defined (BLARGG_DISABLE_AVX2) && \
+				((defined (__GNUC__) && (__GNUC__ >= 5 || defined (__clang__))) || \
+				(defined (_MSC_VER) && _MSC_VER >= 1700))
+			#define BLARGG_SIMD_AVX2 1
+			#include <immintrin.h>
+			#ifdef _MSC_VER
+				#include <intrin.h>
+			#endif
+		#endif
+	#endif
+#endif
+
+// BLARGG_TARGET_AVX2: Lets a single function use AVX2 without enabling it for
+// the whole file. MSVC needs nothing special, but clang-cl (which defines
+// _MSC_VER and not __GNUC__) does.
+#if BLARGG_SIMD_AVX2 && (defined (__GNUC__) || defined (__clang__))
+	#define BLARGG_TARGET_AVX2 __attribute__ ((target ("avx2")))
+#else
+	#define BLARGG_TARGET_AVX2
+#endif
+
+// BLARGG_FLATTEN: Inlines everything a function calls, so that a generic
+// template called from a BLARGG_TARGET_AVX2 function is compiled for AVX2 too.
+#if defined (__GNUC__) || defined (__clang__)
+	#define BLARGG_FLATTEN __attribute__ ((flatten))
+#else
+	#define BLARGG_FLATTEN
+#endif
+
+enum blargg_simd_t {
+	blargg_simd_none = 0,
+	blargg_simd_sse2 = 1,
+	blargg_simd_avx2 = 2
+};
+
+// Best instruction set supported by compiler and host CPU. Determined once.
+// clang-cl uses the MSVC path below, and like clang only allows _xgetbv() in
+// functions targeting XSAVE.
+#if BLARGG_SIMD_AVX2 && defined (__clang__) && !defined (__GNUC__)
+	__attribute__ ((target ("xsave")))
+#endif
+inline blargg_simd_t blargg_simd_detect_()
+{
+	#if BLARGG_SIMD_AVX2
+		#if defined (__GNUC__)
+			__builtin_cpu_init();
+			if ( __builtin_cpu_supports( "avx2" ) )
+				return blargg_simd_avx2;
+		#else
+			int info [4];
+			__cpuid( info, 0 );
+			if ( info [0] >= 7 )
+			{
+				__cpuid( info, 1 );
+				bool const os_avx = (info [2] & (1 << 27)) && (info [2] & (1 << 28)) &&
+						(_xgetbv( 0 ) & 6) == 6;
+				__cpuidex( info, 7, 0 );
+				if ( os_avx && (info [1] & (1 << 5)) )
+					return blargg_simd_avx2;
+			}
+		#endif
+	#endif
+
+	#if BLARGG_SIMD_SSE2
+		return blargg_simd_sse2;
+	#else
+		return blargg_simd_none;
+	#endif
+}
+
+inline blargg_simd_t blargg_simd_level()
+{
+	static blargg_simd_t const level = blargg_simd_detect_();
+	return level;
+}
+
+#endif
@@ -178,6 +178,9 @@ static unsigned char default_inst[OPLL_TONE_NUM][(16 + 3) * 8] = {
 static e_uint32 clk = 844451141;
 /* Sampling rate */
 static e_uint32 rate = 3354932;
+/* Rate the phase tables were last built for. The tables are shared by every
+   OPLL, so they're only rewritten when this actually changes. */
+static e_uint32 table_rate = 3354932;
 
 /* WaveTable for each envelope amp */
 static e_uint16 fullsintable[PG_WIDTH];
@@ -985,9 +988,9 @@ maketables (e_uint32 c, e_uint32 r)
     makeDefaultPatch ();
   }
 
-  if (r != rate)
+  if (r != table_rate)
   {
-    rate = r;
+    rate = table_rate = r;
     internal_refresh ();
   }
 }
@@ -1107,12 +1110,14 @@ OPLL_forceRefresh (OPLL * opll)
 void
 OPLL_set_rate (OPLL * opll, e_uint32 r)
 {
-  if (opll->quality)
-    rate = 49716;
-  else
+  e_uint32 const want = opll->quality ? 49716 : r;
+  if (want != table_rate)
+  {
+    rate = table_rate = want;
+    internal_refresh ();
+  }
+  if (rate != r)
     rate = r;
-  internal_refresh ();
-  rate = r;
 }
 
 void
@@ -2125,3 +2130,71 @@ OPLL_calc_stereo (OPLL * opll, e_int32 **out, e_int32 samples, e_int32 ch)
   }
 }
 #endif /* EMU2413_COMPACTION */
+
+/* Block synthesis with separate channel outputs. Runs the chip for 'samples'
+   samples at the OPLL rate (quality and panning are ignored) and stores each
+   voice's output in out[voice][0..samples-1], using the voice numbering of
+   OPLL_SetMuteMask(); out needs 6 entries in VRC7 mode, otherwise 14.
+   Values are what OPLL_calc_stereo() adds to each side before its final
+   << 3. Every voice is updated even if its out[] is NULL, so the result
+   doesn't depend on which outputs are used. */
+void
+OPLL_calc_channels (OPLL * opll, e_int32 **out, e_int32 samples)
+{
+  e_int32 v[14];
+  e_int32 voices = opll->vrc7_mode ? 6 : 14;
+  e_int32 slots = opll->vrc7_mode ? 12 : 18; /* VRC7 has no channels 6-8 */
+  e_int32 i, n;
+
+  for (n = 0; n < samples; n++)
+  {
+    update_ampm (opll);
+    update_noise (opll);
+
+    for (i = 0; i < slots; i++)
+    {
+      calc_phase(&opll->slot[i],opll->lfo_pm);
+      calc_envelope(&opll->slot[i],opll->lfo_am);
+    }
+
+    for (i = 0; i < voices; i++)
+      v[i] = 0;
+
+    for (i = 0; i < (opll->vrc7_mode ? 6 : 9); i++)
+    {
+      if (i >= 6 && opll->patch_number[i] > 15)
+        continue;
+      if (!(opll->mask & OPLL_MASK_CH (i)) && (CAR(opll,i)->eg_mode != FINISH))
+        v[i] = calc_slot_car (CAR(opll,i), calc_slot_mod (MOD(opll,i)));
+    }
+
+    if (! opll->vrc7_mode)
+    {
+      if (opll->patch_number[6] > 15)
+      {
+        if (!(opll->mask & OPLL_MASK_BD) && (CAR(opll,6)->eg_mode != FINISH))
+          v[9] = calc_slot_car (CAR(opll,6), calc_slot_mod (MOD(opll,6))) << 1;
+      }
+
+      if (opll->patch_number[7] > 15)
+      {
+        if (!(opll->mask & OPLL_MASK_HH) && (MOD(opll,7)->eg_mode != FINISH))
+          v[13] = calc_slot_hat (MOD(opll,7), CAR(opll,8)->pgout, opll->noise_seed&1) << 1;
+        if (!(opll->mask & OPLL_MASK_SD) && (CAR(opll,7)->eg_mode != FINISH))
+          v[10] = -(calc_slot_snare (CAR(opll,7), opll->noise_seed&1) << 1);
+      }
+
+      if (opll->patch_number[8] > 15)
+      {
+        if (!(opll->mask & OPLL_MASK_TOM) && (MOD(opll,8)->eg_mode != FINISH))
+          v[11] = calc_slot_tom (MOD(opll,8)) << 1;
+        if (!(opll->mask & OPLL_MASK_CYM) && (CAR(opll,8)->eg_mode != FINISH))
+          v[12] = -(calc_slot_cym (CAR(opll,8), MOD(opll,7)->pgout) << 1);
+      }
+    }
+
+    for (i = 0; i < voices; i++)
+      if (out[i])
+        out[i][n] = v[i];
+  }
+}
@@ -130,6 +130,7 @@ EMU2413_API void OPLL_advance (OPLL *);
 /* Synthsize */
 EMU2413_API e_int16 OPLL_calc(OPLL *) ;
 EMU2413_API void OPLL_calc_stereo(OPLL *, e_int32 **out, e_int32 samples, e_int32 ch) ; /* ch = -1 for normal operation */
+EMU2413_API void OPLL_calc_channels(OPLL *, e_int32 **out, e_int32 samples) ; /* out[voice] may be NULL */
 
 /* Misc */
 EMU2413_API void OPLL_setPatch(OPLL *, const e_uint8 *dump) ;
@@ -10,6 +10,7 @@
 #if !GME_DISABLE_STEREO_DEPTH
 #include "Effects_Buffer.h"
 #endif
+#include "Music_Stream.h"
 #include "blargg_endian.h"
 #include <string.h>
 #include <ctype.h>
@@ -400,6 +401,19 @@ int       gme_tell_scaled    ( Music_Emu const* me )                { return me-
 gme_err_t gme_seek           ( Music_Emu* me, int msec )            { return me->seek( msec ); }
 gme_err_t gme_seek_samples   ( Music_Emu* me, int n )               { return me->seek_samples( n ); }
 gme_err_t gme_seek_scaled    ( Music_Emu* me, int msec )            { return me->seek_scaled( msec ); }
+int64_t   gme_tell64         ( Music_Emu const* me )                { return me->tell64(); }
+int64_t   gme_tell_samples64 ( Music_Emu const* me )                { return me->tell_samples64(); }
+int64_t   gme_tell_scaled64  ( Music_Emu const* me )                { return me->tell_scaled64(); }
+gme_err_t gme_seek64         ( Music_Emu* me, int64_t msec )        { return me->seek64( msec ); }
+gme_err_t gme_seek_samples64 ( Music_Emu* me, int64_t n )           { return me->seek_samples64( n ); }
+gme_err_t gme_seek_scaled64  ( Music_Emu* me, int64_t msec )        { return me->seek_scaled64( msec ); }
+gme_err_t gme_post_mute_voices( Music_Emu* me, int mask )           { return me->post_mute_voices( mask ); }
+gme_err_t gme_post_tempo     ( Music_Emu* me, double t )            { return me->post_tempo( t ); }
+gme_err_t gme_post_equalizer ( Music_Emu* me, gme_equalizer_t const* eq ) { return me->post_equalizer( *eq ); }
+gme_err_t gme_post_disable_echo( Music_Emu* me, int disable )       { return me->post_disable_echo( disable != 0 ); }
+gme_err_t gme_post_fade_msecs( Music_Emu* me, int start_msec, int length_msec ) { return me->post_fade( start_msec, length_msec ); }
+void      gme_get_stats      ( Music_Emu const* me, gme_stats_t* out ) { me->get_stats( out ); }
+void      gme_enable_stats_timing( Music_Emu* me, int enabled )     { me->enable_stats_timing( enabled != 0 ); }
 int       gme_voice_count    ( Music_Emu const* me )                { return me->voice_count(); }
 void      gme_ignore_silence ( Music_Emu* me, int disable )         { me->ignore_silence( disable != 0 ); }
 void      gme_set_tempo      ( Music_Emu* me, double t )            { me->set_tempo( t ); }
@@ -416,6 +430,8 @@ const uint8_t* gme_regs		 ( Music_Emu* me )
 }
 void      gme_disable_echo   ( Music_Emu* me, int disable )         { me->disable_echo( disable ); }
 void      gme_enable_accuracy( Music_Emu* me, int enabled )         { me->enable_accuracy( enabled ); }
+gme_err_t gme_set_quality    ( Music_Emu* me, int quality )         { return me->set_quality( quality ); }
+int       gme_preferred_sample_rate( Music_Emu const* me )          { return (int) me->preferred_sample_rate(); }
 void      gme_clear_playlist ( Music_Emu* me )                      { me->clear_playlist(); }
 int       gme_type_multitrack( gme_type_t t )                       { return t->track_count != 1; }
 int       gme_multi_channel  ( Music_Emu const* me )                { return me->multi_channel(); }
@@ -470,3 +486,59 @@ const char* gme_type_system( gme_type_t type )
 	assert( type );
 	return type->system;
 }
+
+gme_err_t gme_stream_new( Music_Emu* me, int buffer_size, Music_Stream** out )
+{
+	*out = NULL;
+
+	Music_Stream* stream = BLARGG_NEW Music_Stream;
+	CHECK_ALLOC( stream );
+
+	gme_err_t err = stream->start( me, buffer_size );
+	if ( err )
+	{
+		delete stream;
+		return err;
+	}
+
+	*out = stream;
+	return 0;
+}
+
+gme_err_t gme_stream_start_track( Music_Emu* me, int index, int buffer_size, Music_Stream** out )
+{
+	*out = NULL;
+
+	Music_Stream* stream = BLARGG_NEW Music_Stream;
+	CHECK_ALLOC( stream );
+
+	gme_err_t err = stream->start_track( me, index, buffer_size );
+	if ( err )
+	{
+		delete stream;
+		return err;
+	}
+
+	*out = stream;
+	return 0;
+}
+
+int gme_stream_ready( Music_Stream const* stream ) { return stream->ready(); }
+
+gme_err_t gme_stream_queue_track( Music_Stream* stream, Music_Emu* next, int index, int crossfade )
+{
+	return stream->queue_track( next, index, crossfade != 0 );
+}
+
+int gme_stream_queued( Music_Stream const* stream ) { return stream->track_queued(); }
+
+void gme_stream_delete( Music_Stream* stream ) { delete stream; }
+
+int gme_stream_read( Music_Stream* stream, int count, short out [] ) { return (int) stream->read( count, out ); }
+
+int gme_stream_avail( Music_Stream const* stream )     { return (int) stream->avail(); }
+int gme_stream_size( Music_Stream const* stream )      { return (int) stream->size(); }
+int gme_stream_underruns( Music_Stream const* stream ) { return (int) stream->underrun_count(); }
+int gme_stream_ended( Music_Stream const* stream )     { return stream->track_ended(); }
+
+gme_err_t gme_stream_error( Music_Stream const* stream ) { return stream->error(); }
@@ -5,6 +5,7 @@
 #define GME_H
 
 #include "blargg_source.h"
+#include <stdint.h>
 
 #ifdef __cplusplus
 	extern "C" {
@@ -93,6 +94,17 @@ BLARGG_EXPORT gme_err_t gme_seek_samples( Music_Emu*, int n );
  * @since 0.6.5 */
 BLARGG_EXPORT gme_err_t gme_seek_scaled( Music_Emu*, int msec );
 
+/* Same as gme_tell(), gme_tell_samples(), gme_tell_scaled(), gme_seek(),
+gme_seek_samples() and gme_seek_scaled(), but with 64-bit times. The int versions
+overflow after several hours of playback, or less than an hour with multi-channel
+output. */
+BLARGG_EXPORT int64_t gme_tell64( Music_Emu const* );
+BLARGG_EXPORT int64_t gme_tell_samples64( Music_Emu const* );
+BLARGG_EXPORT int64_t gme_tell_scaled64( Music_Emu const* );
+BLARGG_EXPORT gme_err_t gme_seek64( Music_Emu*, int64_t msec );
+BLARGG_EXPORT gme_err_t gme_seek_samples64( Music_Emu*, int64_t n );
+BLARGG_EXPORT gme_err_t gme_seek_scaled64( Music_Emu*, int64_t msec );
+
 
 /******** Informational ********/
 
@@ -216,6 +228,68 @@ BLARGG_EXPORT void gme_set_equalizer( Music_Emu*, gme_equalizer_t const* eq );
 /* Enables/disables most accurate sound emulation options */
 BLARGG_EXPORT void gme_enable_accuracy( Music_Emu*, int enabled );
 
+/* Sample rate the loaded file's sound chips generate samples at, or 0 if the emulator
+synthesizes sound directly at any rate. An emulator created with this sample rate
+doesn't resample internally (SPC, and VGM and GYM FM sound), which avoids resampling
+twice when output will be resampled anyway. Also works for gme_info_only emulators,
+so the rate can be found before opening the file for playback. */
+BLARGG_EXPORT int gme_preferred_sample_rate( Music_Emu const* );
+
+/* Trade sound quality for speed, for previews and waveform displays. Draft uses
+narrower resampling filters for SPC, VGM and GYM, and runs the Gens YM2612 emulator
+at half the output rate. High runs the YM2612 at the chip's own rate for VGM.
+Normal is the default. Must be called before loading a file; returns an error after. */
+enum { gme_quality_draft = -1, gme_quality_normal = 0, gme_quality_high = 1 };
+BLARGG_EXPORT gme_err_t gme_set_quality( Music_Emu*, int quality );
+
+
+/******** Thread-safe control ********/
+
+/* Same as gme_mute_voices(), gme_set_tempo(), gme_set_equalizer(),
+gme_disable_echo() and gme_set_fade_msecs(), except that these can be called from
+any thread, even while another is in gme_play() (or a Music_Stream is rendering).
+Changes are queued without blocking and applied in order at the beginning of the
+next gme_play() or gme_skip(). Returns an error if too many changes are already
+waiting. */
+BLARGG_EXPORT gme_err_t gme_post_mute_voices( Music_Emu*, int muting_mask );
+BLARGG_EXPORT gme_err_t gme_post_tempo( Music_Emu*, double tempo );
+BLARGG_EXPORT gme_err_t gme_post_equalizer( Music_Emu*, gme_equalizer_t const* eq );
+BLARGG_EXPORT gme_err_t gme_post_disable_echo( Music_Emu*, int disable );
+BLARGG_EXPORT gme_err_t gme_post_fade_msecs( Music_Emu*, int start_msec, int length_msecs );
+
+
+/******** Performance statistics ********/
+
+/* Counters for the current track, for finding where time goes when playback
+can't keep up. Counts are always kept. Times are only measured after
+gme_enable_stats_timing(), and are in nanoseconds. */
+typedef struct gme_stats_t
+{
+	int64_t samples_played;    /* samples output by gme_play() or skipped by gme_seek() */
+	int64_t samples_emulated;  /* samples generated by emulator, including look-ahead */
+	int64_t lookahead_samples; /* samples generated ahead while looking for silence */
+	int64_t cpu_clocks;        /* clocks run by the CPU (or main sound chip) */
+	int64_t cpu_idle_clocks;   /* part of cpu_clocks skipped in idle loops */
+	int64_t apu_writes;        /* writes to sound chip registers */
+	int64_t samples_resampled; /* samples output by a resampler */
+
+	int64_t play_nsec;         /* total time in gme_play() and gme_seek() */
+	int64_t emulate_nsec;      /* running the emulator, including the stages below */
+	int64_t lookahead_nsec;    /* running ahead while looking for silence */
+	int64_t mix_nsec;          /* reading Blip_Buffer output */
+	int64_t resample_nsec;     /* resampling */
+
+	int64_t reserved [8];
+} gme_stats_t;
+
+/* Gets counters for current track. Must not be called while another thread is
+in gme_play(). */
+BLARGG_EXPORT void gme_get_stats( Music_Emu const*, gme_stats_t* out );
+
+/* Enables/disables measuring of time spent, which costs a few reads of the system
+clock per gme_play() */
+BLARGG_EXPORT void gme_enable_stats_timing( Music_Emu*, int enabled );
+
 
 /******** Game music types ********/
 
@@ -323,6 +397,63 @@ BLARGG_EXPORT gme_err_t gme_load_custom( Music_Emu*, gme_reader_t, long file_siz
 BLARGG_EXPORT gme_err_t gme_load_m3u_data( Music_Emu*, void const* data, long size );
 
 
+/******** Render-ahead streaming ********/
+
+/* Renders an emulator on a worker thread into a lock-free buffer, so that
+samples can be read from an audio callback without waiting for emulation. */
+typedef struct Music_Stream Music_Stream;
+
+/* Start rendering current track of emulator into a buffer of at least buffer_size
+samples. Emulator must not be used again until stream is deleted. Sets *out to
+new stream. */
+BLARGG_EXPORT gme_err_t gme_stream_new( Music_Emu*, int buffer_size, Music_Stream** out );
+
+/* Start track and stream it as with gme_stream_new(), without waiting for the
+library to skip silence at the beginning of the track (see gme_ignore_silence()).
+This is done on the worker thread, and reads return silence until
+gme_stream_ready(). */
+BLARGG_EXPORT gme_err_t gme_stream_start_track( Music_Emu*, int index, int buffer_size, Music_Stream** out );
+
+/* True once the first samples of the track are ready to be read */
+BLARGG_EXPORT int gme_stream_ready( Music_Stream const* );
+
+/* Queue track of next emulator to play after the current track of the stream,
+with no gap between the last non-silent sample of one and the first of the other.
+Next track is started and searched for initial silence ahead of time. If crossfade
+is nonzero, next track instead starts when current track starts fading out (see
+gme_set_fade_msecs()), mixed with it. next must have the same sample rate and
+channel count, and must not be used until gme_stream_queued() returns false. It
+may also be the emulator currently playing, in which case the track is started
+when the current one ends. */
+BLARGG_EXPORT gme_err_t gme_stream_queue_track( Music_Stream*, Music_Emu* next, int index, int crossfade );
+
+/* True while a queued track hasn't started playing. Once false, the previous
+emulator is free to be used or deleted. */
+BLARGG_EXPORT int gme_stream_queued( Music_Stream const* );
+
+/* Stop rendering and free stream */
+BLARGG_EXPORT void gme_stream_delete( Music_Stream* );
+
+/* Copy up to count samples into out and return the number copied. Never blocks.
+The rest of out is filled with silence. count must be a multiple of the channel
+count (2, or 16 for multichannel emulators). */
+BLARGG_EXPORT int gme_stream_read( Music_Stream*, int count, short out [] );
+
+/* Number of samples ready to be read, out of gme_stream_size() */
+BLARGG_EXPORT int gme_stream_avail( Music_Stream const* );
+BLARGG_EXPORT int gme_stream_size( Music_Stream const* );
+
+/* Number of reads that found fewer samples ready than requested, after the
+track became ready and before it ended */
+BLARGG_EXPORT int gme_stream_underruns( Music_Stream const* );
+
+/* True once track has ended and all of it has been read */
+BLARGG_EXPORT int gme_stream_ended( Music_Stream const* );
+
+/* Error that stopped rendering, or NULL */
+BLARGG_EXPORT gme_err_t gme_stream_error( Music_Stream const* );
+
+
 /******** User data ********/
 
 /* Set/get pointer to data you want to associate with this emulator.
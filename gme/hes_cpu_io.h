@@ -52,39 +52,6 @@ inline byte const* Hes_Emu::cpu_set_mmr( int page, int bank )
 	return data;
 }
 
-#define CPU_READ_FAST( cpu, addr, time, out ) \
-	CPU_READ_FAST_( STATIC_CAST(Hes_Emu*,cpu), addr, time, out )
-
-#define CPU_READ_FAST_( cpu, addr, time, out ) \
-{\
-	out = READ_PROG( addr );\
-	if ( mmr [addr >> page_shift] == 0xFF )\
-	{\
-		FLUSH_TIME();\
-		out = cpu->cpu_read_( addr );\
-		CACHE_TIME();\
-	}\
-}
-
-#define CPU_WRITE_FAST( cpu, addr, data, time ) \
-	CPU_WRITE_FAST_( STATIC_CAST(Hes_Emu*,cpu), addr, data, time )
-
-#define CPU_WRITE_FAST_( cpu, addr, data, time ) \
-{\
-	byte* out = cpu->write_pages [addr >> page_shift];\
-	addr &= page_size - 1;\
-	if ( out )\
-	{\
-		out [addr] = data;\
-	}\
-	else if ( mmr [addr >> page_shift] == 0xFF )\
-	{\
-		FLUSH_TIME();\
-		cpu->cpu_write_( addr, data );\
-		CACHE_TIME();\
-	}\
-}
-
 #define CPU_READ( cpu, addr, time ) \
 	STATIC_CAST(Hes_Emu*,cpu)->cpu_read( addr )
 
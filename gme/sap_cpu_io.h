@@ -13,7 +13,7 @@ void Sap_Emu::cpu_write( sap_addr_t addr, int data )
 }
 
 #ifdef NDEBUG
-	#define CPU_READ( cpu, addr, time )     READ_LOW( addr )
+	#define CPU_READ( cpu, addr, time )     ((cpu)->mem [addr])
 #else
 	#define CPU_READ( cpu, addr, time )     STATIC_CAST(Sap_Emu&,*cpu).cpu_read( addr )
 
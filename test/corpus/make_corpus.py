@@ -0,0 +1,365 @@
+#!/usr/bin/env python3
+"""Generates the benchmark corpus: one small file per format and NSF
+expansion chip, each a short program that keeps every voice of its sound
+hardware playing. The files are original, contain no copyrighted music and
+may be redistributed freely. Run from any directory; the files are written
+next to this script.
+
+Every program steps through the same 16-note pattern, one note per eight
+frames, with each voice offset a few notes from the previous one."""
+
+import os
+import random
+import struct
+
+here = os.path.dirname( os.path.abspath( __file__ ) )
+
+def save( name, data ):
+    with open( os.path.join( here, name ), 'wb' ) as f:
+        f.write( bytes( data ) )
+
+def le( v ): return [v & 0xFF, v >> 8 & 0xFF]
+def be( v ): return [v >> 8 & 0xFF, v & 0xFF]
+
+# Low bytes of periods (falling) or frequencies (rising) over a pentatonic
+# scale; a voice reads from its own offset of up to 16 into the table
+steps   = [octave * 12 + s for octave in range( 7 ) for s in (0, 2, 4, 7, 9)] [:32]
+periods = [int( 0xFC * 2 ** (-s / 36.0) ) for s in steps]
+freqs   = [int( 0x30 * 2 ** ( s / 36.0) ) for s in steps]
+
+#### 6502 (NSF, SAP, HES)
+
+def lda( v ):        return [0xA9, v]
+def sta( a ):        return [0x8D] + le( a )
+def poke( a, v ):    return lda( v ) + sta( a )
+def from_table( table, voice, a ): # LDA table+voice,X / STA a
+    return [0xBD] + le( table + voice ) + sta( a )
+
+# INC counter / X = note index
+def note_index( counter ):
+    return [0xE6, counter, 0xA5, counter, 0x4A, 0x4A, 0x4A, 0x29, 0x0F, 0xAA]
+
+# Y = 0..count-1 loop that stores Y-derived values; body gets A = Y
+def fill( count, body ):
+    code = [0xA0, 0x00, 0x98] + body + [0xC8, 0xC0, count]
+    return code + [0xD0, -len( code ) & 0xFF]
+
+#### NSF
+
+nsf_org   = 0x8000
+nsf_table = 0x8F00
+
+apu_init = ( poke( 0x4015, 0x0F ) + poke( 0x4000, 0xBF ) + poke( 0x4001, 0x08 ) +
+        poke( 0x4003, 0x01 ) + poke( 0x4004, 0x7F ) + poke( 0x4005, 0x08 ) +
+        poke( 0x4007, 0x01 ) + poke( 0x4008, 0xFF ) + poke( 0x400B, 0x01 ) +
+        poke( 0x400C, 0x36 ) + poke( 0x400F, 0x08 ) )
+apu_play = ( from_table( nsf_table, 0, 0x4002 ) + from_table( nsf_table, 4, 0x4006 ) +
+        from_table( nsf_table, 7, 0x400A ) +
+        [0xA5, 0x10, 0x29, 0x0F, 0x8D, 0x0E, 0x40] +          # noise period
+        [0xA5, 0x10, 0x0A, 0x29, 0x3F, 0x8D, 0x11, 0x40] )    # DMC DAC ramp
+
+def vrc7( reg, value ):
+    return poke( 0x9010, reg ) + value + sta( 0x9030 )
+
+def n163( addr ):
+    return poke( 0xF800, addr )
+
+chips = {
+    'apu': (0x00, [], []),
+    'vrc6': (0x01,
+        poke( 0x9003, 0x00 ) + poke( 0x9000, 0x4A ) + poke( 0xA000, 0x2A ) + poke( 0xB000, 0x12 ) +
+        poke( 0x9002, 0x81 ) + poke( 0xA002, 0x81 ) + poke( 0xB002, 0x81 ),
+        from_table( nsf_table, 2, 0x9001 ) + from_table( nsf_table, 5, 0xA001 ) +
+        from_table( nsf_table, 9, 0xB001 ) ),
+    'vrc7': (0x02,
+        sum( (vrc7( 0x30 + ch, lda( (ch + 1) << 4 | 2 ) ) for ch in range( 6 )), [] ),
+        sum( (vrc7( 0x10 + ch, [0xBD] + le( nsf_table + ch * 3 ) ) +
+              vrc7( 0x20 + ch, [0xA5, 0x10, 0x29, 0x10, 0x09, 0x08 + (ch & 1) * 2] )
+              for ch in range( 6 )), [] ) ),
+    'fds': (0x04,
+        poke( 0x4089, 0x80 ) + fill( 64, [0x99, 0x40, 0x40] ) + poke( 0x4089, 0x00 ) +
+        poke( 0x4087, 0x80 ) + fill( 32, [0x29, 0x07, 0x8D, 0x88, 0x40] ) +
+        poke( 0x4084, 0x83 ) + poke( 0x4085, 0x00 ) + poke( 0x4086, 0x18 ) + poke( 0x4087, 0x00 ) +
+        poke( 0x4080, 0xA0 ) + poke( 0x4083, 0x02 ),
+        from_table( nsf_table, 3, 0x4082 ) ),
+    'mmc5': (0x08,
+        poke( 0x5015, 0x03 ) + poke( 0x5000, 0xBF ) + poke( 0x5004, 0x7F ) +
+        poke( 0x5003, 0x01 ) + poke( 0x5007, 0x01 ) + poke( 0x5010, 0x00 ),
+        from_table( nsf_table, 2, 0x5002 ) + from_table( nsf_table, 6, 0x5006 ) +
+        [0xA5, 0x10, 0x8D, 0x11, 0x50] ),
+    'namco': (0x10,
+        n163( 0x80 ) + fill( 16, [0x0A, 0x0A, 0x0A, 0x0A, 0x09, 0x08, 0x8D, 0x00, 0x48] ) +
+        sum( (n163( 0x80 | base ) + lda( 0 ) + sta( 0x4800 ) + sta( 0x4800 ) + lda( 0x10 ) +
+              sta( 0x4800 ) + lda( 0 ) + sta( 0x4800 ) + lda( 0xE0 ) + sta( 0x4800 ) + lda( 0 ) +
+              sta( 0x4800 ) + sta( 0x4800 ) + lda( 0x3F if base == 0x78 else 0x0F ) + sta( 0x4800 )
+              for base in (0x78, 0x70, 0x68, 0x60)), [] ),
+        sum( (n163( 0x7A - ch * 8 ) + [0xBD] + le( nsf_table + ch * 4 ) + sta( 0x4800 )
+              for ch in range( 4 )), [] ) ),
+    'fme7': (0x20,
+        sum( (poke( 0xC000, r ) + poke( 0xE000, v ) for r, v in
+              ((1, 1), (3, 1), (5, 0), (6, 0x08), (7, 0x30), (8, 0x0F), (9, 0x0D), (10, 0x0B))), [] ),
+        sum( (poke( 0xC000, r ) + from_table( nsf_table, voice, 0xE000 )
+              for r, voice in ((0, 1), (2, 5), (4, 10))), [] ) ),
+}
+
+def nsf( name, chip ):
+    flags, chip_init, chip_play = chips [chip]
+    init = apu_init + chip_init + [0x60]
+    play = note_index( 0x10 ) + apu_play + chip_play + [0x60]
+    code = init + [0] * (0x400 - len( init )) + play
+    code += [0] * (nsf_table - nsf_org - len( code )) + periods
+    h = b'NESM\x1a' + bytes( [1, 1, 1] + le( nsf_org ) + le( nsf_org ) + le( nsf_org + 0x400 ) )
+    h += name.encode().ljust( 32, b'\0' ) + b'libgme corpus'.ljust( 32, b'\0' ) + b'public domain'.ljust( 32, b'\0' )
+    h += bytes( le( 16639 ) + [0] * 8 + le( 19997 ) + [0, flags, 0, 0, 0, 0] )
+    assert len( h ) == 0x80
+    save( name, h + bytes( code ) )
+
+#### SAP
+
+def sap():
+    org = 0x2000
+    table = org + 0x200
+    init = ( poke( 0xD208, 0 ) + poke( 0xD20F, 3 ) + poke( 0xD218, 0 ) + poke( 0xD21F, 3 ) +
+            sum( (poke( 0xD201 + ch * 2, 0xA8 ) + poke( 0xD211 + ch * 2, 0xA6 ) for ch in range( 3 )), [] ) +
+            poke( 0xD207, 0x86 ) + poke( 0xD217, 0x24 ) + [0x60] )
+    play = ( note_index( 0x80 ) +
+            sum( (from_table( table, ch * 2, 0xD200 + ch * 2 ) + from_table( table, ch * 2 + 1, 0xD210 + ch * 2 )
+                  for ch in range( 4 )), [] ) + [0x60] )
+    code = init + [0] * (0x100 - len( init )) + play
+    code += [0] * (0x200 - len( code )) + periods
+    hdr = (b'SAP\r\nAUTHOR "libgme corpus"\r\nNAME "sap"\r\nDATE "public domain"\r\nSTEREO\r\n'
+            b'TYPE B\r\nINIT %04X\r\nPLAYER %04X\r\n' % (org, org + 0x100))
+    save( 'atari.sap', hdr + bytes( [0xFF, 0xFF] + le( org ) + le( org + len( code ) - 1 ) + code ) )
+
+#### HES
+
+def hes():
+    org = 0xE000
+    table = org + 0x200
+    init = poke( 0x0801, 0xFF )
+    for ch in range( 6 ):
+        init += ( poke( 0x0800, ch ) + poke( 0x0804, 0x00 ) +
+                fill( 32, [0x29, 0x1F >> (ch & 1), 0x8D, 0x06, 0x08] ) +
+                poke( 0x0803, 0x01 ) + poke( 0x0805, (0xFF, 0xFF, 0xF8, 0x8F, 0xDD, 0xBB) [ch] ) +
+                poke( 0x0804, 0x9C ) )
+    init += ( poke( 0x0807, 0x9C ) + poke( 0x0C00, 0x73 ) + poke( 0x0C01, 0x01 ) +
+            poke( 0x1402, 0x03 ) + [0x58, 0x60] )
+    irq = [0x48, 0xDA] + sta( 0x1403 ) + note_index( 0x10 )
+    for ch in range( 6 ):
+        irq += poke( 0x0800, ch ) + from_table( table, ch * 3, 0x0802 )
+    irq += [0xFA, 0x68, 0x40]
+    rom = bytearray( 0x2000 )
+    rom [0:len( init )] = bytes( init )
+    rom [0x100:0x100 + len( irq )] = bytes( irq )
+    rom [0x200:0x200 + len( periods )] = bytes( periods )
+    rom [0x1FFA:0x1FFC] = bytes( le( org + 0x100 ) )
+    h = b'HESM' + bytes( [0, 0] + le( org ) + [0xFF, 0xF8, 0, 0, 0, 0, 0, 0] )
+    h += b'DATA' + struct.pack( '<III', len( rom ), 0, 0 )
+    save( 'pce.hes', h + bytes( rom ) )
+
+#### Z80 and LR35902 (KSS, AY, GBS)
+
+# HL = table + note index, counter at addr. The Game Boy CPU has different
+# opcodes for LD A,(nn) and LD (nn),A.
+def z80_note_index( counter, table, gb = False ):
+    load, store = (0xFA, 0xEA) if gb else (0x3A, 0x32)
+    return ( [load] + le( counter ) + [0x3C, store] + le( counter ) +
+            [0x0F, 0x0F, 0x0F, 0xE6, 0x0F, 0x5F, 0x16, 0x00, 0x21] + le( table ) + [0x19] )
+
+def kss():
+    org = 0x0100
+    table = org + 0x200
+    init = []
+    for r, v in ((1, 1), (3, 1), (5, 0), (7, 0x38), (8, 0x0D), (9, 0x0B), (10, 0x09)):
+        init += [0x3E, r, 0xD3, 0xA0, 0x3E, v, 0xD3, 0xA1]
+    init += [0x21, 0x00, 0x98, 0x06, 0x80,                              # SCC waves
+            0x78, 0x87, 0x87, 0x87, 0x77, 0x23, 0x10, 0xF8]
+    for ch in range( 5 ):
+        init += [0x3E, 0x01, 0x32] + le( 0x9881 + ch * 2 ) + [0x3E, 0x0C, 0x32] + le( 0x988A + ch )
+    init += [0x3E, 0x1F, 0x32, 0x8F, 0x98, 0xC9]
+    play = z80_note_index( 0xC000, table )
+    for r in (0, 2, 4):
+        play += [0x3E, r, 0xD3, 0xA0, 0x7E, 0xD3, 0xA1, 0x23]
+    for ch in range( 5 ):
+        play += [0x7E, 0x32] + le( 0x9880 + ch * 2 ) + [0x23]
+    play += [0xC9]
+    code = init + [0] * (0x100 - len( init )) + play
+    code += [0] * (0x200 - len( code )) + periods
+    h = b'KSCC' + bytes( le( org ) + le( len( code ) ) + le( org ) + le( org + 0x100 ) + [0, 0, 0, 0] )
+    save( 'msx.kss', h + bytes( code ) )
+
+def ay():
+    table = 0x8200
+    def reg( r, value ): # value loads A
+        return [0x01, 0xFD, 0xFF, 0x3E, r, 0xED, 0x79, 0x06, 0xBF] + value + [0xED, 0x79]
+    init = []
+    for r, v in ((1, 1), (3, 1), (5, 0), (6, 0x0C), (7, 0x1C), (8, 0x0F), (9, 0x0C),
+            (10, 0x10), (11, 0x00), (12, 0x08), (13, 0x0E)):
+        init += reg( r, [0x3E, v] )
+    init += [0xC9]
+    play = z80_note_index( 0x9000, table )
+    for r in (0, 2, 4):
+        play += reg( r, [0x7E] ) + [0x23, 0x23]
+    play += [0xC9]
+    code = init + [0] * (0x100 - len( init )) + play
+    code += [0] * (0x200 - len( code )) + periods
+
+    f = bytearray( b'ZXAYEMUL' + bytes( 12 ) )
+    def ptr( at, target ): f [at:at + 2] = bytes( be( target - at ) )
+    songs = len( f ); f += bytes( 4 )
+    ptr( 18, songs )
+    name = len( f ); f += b'spectrum\0'
+    ptr( songs, name )
+    data = len( f ); f += bytes( 14 )
+    ptr( songs + 2, data )
+    f [data:data + 4] = bytes( [0, 1, 2, 3] )
+    f [data + 4:data + 6] = bytes( be( 0 ) )
+    points = len( f ); f += bytes( be( 0xF000 ) + be( 0x8000 ) + be( 0x8100 ) )
+    ptr( data + 10, points )
+    blocks = len( f ); f += bytes( be( 0x8000 ) + be( len( code ) ) ) + bytes( 4 )
+    ptr( data + 12, blocks )
+    body = len( f ); f += bytes( code )
+    ptr( blocks + 4, body )
+    save( 'spectrum.ay', f )
+
+def gbs():
+    org = 0x0400
+    table = org + 0x200
+    def ldh( r, v ): return [0x3E, v, 0xE0, r]
+    init = ( ldh( 0x26, 0x80 ) + ldh( 0x24, 0x77 ) + ldh( 0x25, 0xFF ) +
+            ldh( 0x10, 0x00 ) + ldh( 0x11, 0x80 ) + ldh( 0x12, 0xF0 ) + ldh( 0x14, 0x87 ) +
+            ldh( 0x16, 0x40 ) + ldh( 0x17, 0xF3 ) + ldh( 0x19, 0x87 ) +
+            ldh( 0x1A, 0x00 ) +
+            [0x21] + le( org + 0x1F0 ) + [0x0E, 0x30, 0x06, 0x10, 0x2A, 0xE2, 0x0C, 0x05, 0x20, 0xFA] +
+            ldh( 0x1A, 0x80 ) + ldh( 0x1B, 0x00 ) + ldh( 0x1C, 0x20 ) + ldh( 0x1E, 0x87 ) +
+            ldh( 0x20, 0x00 ) + ldh( 0x21, 0xF2 ) + ldh( 0x22, 0x35 ) + ldh( 0x23, 0x80 ) + [0xC9] )
+    play = z80_note_index( 0xC000, table, gb = True )
+    play += [0x7E, 0xE0, 0x13, 0x3E, 0x07, 0xE0, 0x14]                       # square 1
+    play += [0x23, 0x23, 0x23, 0x7E, 0xE0, 0x18]                             # square 2
+    play += [0x23, 0x23, 0x7E, 0xE0, 0x1D, 0x3E, 0x07, 0xE0, 0x1E]           # wave
+    # every 8 frames retrigger square 2 and noise
+    play += [0xFA] + le( 0xC000 ) + [0xE6, 0x07, 0x20, 0x08] + ldh( 0x19, 0x87 ) + ldh( 0x23, 0x80 )
+    play += [0xC9]
+    code = init + [0] * (0x100 - len( init )) + play
+    code += [0] * (0x1F0 - len( code )) + [0x01, 0x23, 0x45, 0x67, 0x89, 0xAB, 0xCD, 0xEF,
+            0xFE, 0xDC, 0xBA, 0x98, 0x76, 0x54, 0x32, 0x10] + [0xFF - f for f in freqs]
+    h = b'GBS' + bytes( [1, 1, 1] + le( org ) + le( org ) + le( org + 0x100 ) + le( 0xFFFE ) + [0, 0] )
+    h += b'gameboy'.ljust( 32, b'\0' ) + b'libgme corpus'.ljust( 32, b'\0' ) + b'public domain'.ljust( 32, b'\0' )
+    assert len( h ) == 0x70
+    save( 'gameboy.gbs', h + bytes( code ) )
+
+#### SPC
+
+def spc():
+    r = random.Random( 1 )
+    ram = bytearray( 0x10000 )
+    # every 24 ms key on the voices set in X and key off the rest
+    prog = [0x8F, 0xC0, 0xFA, 0x8F, 0x01, 0xF1,              # timer 0 at 8 kHz / 192
+            0xCD, 0x00,                                      # X = 0
+            0xE4, 0xFD, 0xF0, 0xFC,                          # wait for timer
+            0x7D, 0x60, 0x88, 0x25, 0x5D,                    # X += $25
+            0x8F, 0x4C, 0xF2, 0x7D, 0xC4, 0xF3,              # KON = X
+            0x8F, 0x5C, 0xF2, 0x7D, 0x48, 0xFF, 0xC4, 0xF3,  # KOFF = ~X
+            0x8F, 0x02, 0xF2, 0xD8, 0xF3,                    # voice 0 pitch = X
+            0x2F]                                            # loop to wait
+    prog.append( 8 - (len( prog ) + 1) & 0xFF )
+    ram [0x200:0x200 + len( prog )] = bytes( prog )
+    # BRR samples with loops
+    addr = 0x1000
+    for s in range( 8 ):
+        start = addr
+        blocks = 16 + s * 4
+        for b in range( blocks ):
+            ram [addr] = (r.randint( 6, 11 ) << 4 | r.randint( 0, 3 ) << 2 | 2 |
+                    (1 if b == blocks - 1 else 0))
+            for i in range( 8 ):
+                ram [addr + 1 + i] = r.randint( 0, 255 )
+            addr += 9
+        struct.pack_into( '<HH', ram, 0x300 + s * 4, start, start + 9 * (blocks // 2) )
+    dsp = bytearray( 128 )
+    adsr = [(0x8F, 0xE0), (0xFF, 0x2A), (0x9F, 0x4F), (0x8E, 0xF1),
+            (0xCF, 0xF3), (0x8B, 0xE0), (0xFE, 0x7E), (0xBF, 0xA9)]
+    for v in range( 8 ):
+        b = v * 0x10
+        dsp [b + 0] = 0x40 + v * 8
+        dsp [b + 1] = 0x7F - v * 8
+        p = 0x800 + v * 0x1A0
+        dsp [b + 2] = p & 0xFF
+        dsp [b + 3] = p >> 8
+        dsp [b + 4] = v
+        dsp [b + 5], dsp [b + 6] = adsr [v]
+    dsp [0x70] = dsp [0x71] = 0x18      # quieter noise voice
+    dsp [0x0C] = dsp [0x1C] = 0x60      # main volume
+    dsp [0x2C] = 0x30                   # echo volume
+    dsp [0x3C] = 0xD0
+    dsp [0x5C] = 0
+    dsp [0x6C] = 0x00                   # echo writes enabled
+    dsp [0x0D] = 0x40                   # echo feedback
+    dsp [0x2D] = 0x0C                   # pitch modulation
+    dsp [0x3D] = 0x80                   # noise on voice 7
+    dsp [0x4D] = 0x5A                   # echo on
+    dsp [0x5D] = 3                      # sample directory at $300
+    dsp [0x6D] = 0x80                   # echo buffer at $8000
+    dsp [0x7D] = 4                      # 64 ms echo delay
+    for i, c in enumerate( [0x0C, 0x21, 0x2B, 0x2B, 0x13, 0xFE, 0xF3, 0xF9] ):
+        dsp [0x0F + i * 0x10] = c
+    f = bytearray( b'SNES-SPC700 Sound File Data v0.30' + b'\x1a\x1a' )
+    f += bytes( [26, 30] + le( 0x200 ) + [0, 0, 0, 0x02, 0xEF, 0, 0] )
+    f += b'snes'.ljust( 32, b'\0' ) + b'libgme corpus'.ljust( 32, b'\0' )
+    f += bytes( 0x100 - len( f ) )
+    f += ram + dsp + bytes( 0x40 ) + bytes( 0x40 )
+    save( 'snes.spc', f )
+
+#### GYM
+
+def gym():
+    h = bytearray( b'GYMX' ) + b'genesis'.ljust( 32, b'\0' ) + b'libgme corpus'.ljust( 32, b'\0' )
+    h += b'public domain'.ljust( 32, b'\0' ) + bytes( 32 * 2 + 256 )
+    h += bytes( le( 1 ) + [0, 0] ) + bytes( 4 )
+    assert len( h ) == 428
+    data = bytearray()
+    def fm( port, a, d ): data.extend( [1 + port, a, d] )
+    # instrument on 5 FM channels, channel 6 as DAC
+    for port in range( 2 ):
+        for ch in range( 3 ):
+            fm( port, 0xB0 + ch, 0x32 )
+            fm( port, 0xB4 + ch, 0xC0 )
+            for op, (mul, tl) in enumerate( ((0x71, 0x23), (0x0D, 0x2D), (0x33, 0x26), (0x01, 0x00)) ):
+                o = op * 4 + ch
+                fm( port, 0x30 + o, mul )
+                fm( port, 0x40 + o, tl )
+                fm( port, 0x50 + o, 0x5F )
+                fm( port, 0x60 + o, 0x05 )
+                fm( port, 0x70 + o, 0x02 )
+                fm( port, 0x80 + o, 0x11 )
+    fm( 0, 0x2B, 0x80 )
+    for frame in range( 600 ):
+        note = frame >> 3 & 15
+        if frame % 8 == 0:
+            for port in range( 2 ):
+                for ch in range( 3 if port == 0 else 2 ):
+                    voice = port * 3 + ch
+                    key = ch | port << 2
+                    fm( 0, 0x28, key )
+                    fm( port, 0xA4 + ch, 0x22 + voice // 2 * 8 )
+                    fm( port, 0xA0 + ch, freqs [note + voice] )
+                    fm( 0, 0x28, 0xF0 | key )
+            for ch in range( 3 ):
+                p = periods [note + ch * 3] * 2 + 0x100
+                data.extend( [3, 0x80 | ch << 5 | (p & 0x0F), 3, p >> 4 & 0x3F, 3, 0x90 | ch << 5 | 4] )
+            data.extend( [3, 0xE4, 3, 0xF6] )
+        if frame % 16 < 4:
+            for i in range( 16 ):
+                fm( 0, 0x2A, 0x80 + (i * 37 & 0x7F) - 0x40 )
+        data.append( 0 )
+    save( 'genesis.gym', h + data )
+
+for name in ('apu', 'vrc6', 'vrc7', 'fds', 'mmc5', 'namco', 'fme7'):
+    nsf( 'nes_%s.nsf' % name, name )
+sap()
+hes()
+kss()
+ay()
+gbs()
+spc()
+gym()